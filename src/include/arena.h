@@ -0,0 +1,29 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+/*
+ * Memory that is handed out from large blocks and is all freed at one time.
+ * Nothing that is allocated from an arena is freed by itself.
+ */
+typedef struct _arena_block {
+    struct _arena_block* next;
+    size_t size;    // bytes of data in this block
+    size_t used;
+    char data[];
+} arena_block_t;
+
+typedef struct {
+    arena_block_t* blocks;  // the first one is the one being allocated from
+    size_t block_size;
+    void* last;             // the most recent allocation, which can grow
+} arena_t;
+
+arena_t* create_arena(size_t block_size);
+void destroy_arena(arena_t* arena);
+void retire_arena(arena_t* arena);
+void flush_quarantine(void);
+void* arena_alloc(arena_t* arena, size_t size);
+void* arena_grow(arena_t* arena, void* ptr, size_t old_size, size_t new_size);
+char* arena_strndup(arena_t* arena, const char* str, size_t len);
+
+#endif
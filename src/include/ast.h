@@ -1,6 +1,10 @@
 #ifndef __AST_H__
 #define __AST_H__
 
+/*
+ * The attributes are a closed set. Each one has its own slot in the node,
+ * which is its type less NAME_ATTR.
+ */
 typedef enum {
     NAME_ATTR = 400,
     TYPE_NAME_ATTR,
@@ -9,6 +13,9 @@ typedef enum {
     IMPORT_NAME_ATTR,
 } ast_attr_type_t;
 
+#define NUM_AST_ATTRS (IMPORT_NAME_ATTR - NAME_ATTR + 1)
+#define AST_ATTR_SLOT(type) ((type) - NAME_ATTR)
+
 typedef enum {
     NUM_ATTR = 500,
     STR_ATTR,
@@ -21,7 +28,7 @@ typedef struct {
     ast_attr_store_type_t stype;
 } ast_attr_map_t;
 
-extern ast_attr_map_t ast_attr_map[]; // defined in ast.c
+extern ast_attr_map_t ast_attr_map[]; // defined in ast.c, in slot order
 
 typedef enum {
     AST_NO_ERROR,
@@ -40,40 +47,114 @@ typedef enum {
     EXPRESSION_ASSIGN_NODE,
     FUNC_PARAM_NODE,
     FUNC_BODY_NODE,
+    NUM_AST_NODE_TYPES,     // not a node type
 } ast_node_types_t;
 
+typedef union {
+    const char* str;    // STR_ATTR
+    int num;            // NUM_ATTR
+} ast_attr_value_t;
+
+/*
+ * A node is the same fixed struct for every node type. The bit of a slot in
+ * attr_mask is set when the node has that attribute. The strings and the
+ * children live in the arena of the tree, so a node does not own anything and
+ * is never freed by itself.
+ */
 typedef struct _ast_node {
-    int node_type;
-    hash_table_t* attribs;
-    data_list_t* members;
+    uint16_t node_type;
+    uint16_t attr_mask;             // bit AST_ATTR_SLOT(type) of each attribute
+    source_loc_t loc;               // where the construct starts
+    ast_attr_value_t attrs[NUM_AST_ATTRS];
+    struct _ast_node** children;    // in the order they were added
+    uint32_t num_children;
+    uint32_t max_children;
 } ast_node_t;
 
-#define ADD_INT_ATTRIB(node, name, val) do { \
-        int v = val; \
-        if(add_node_attrib(node, name, &v, sizeof(int)) != AST_NO_ERROR) \
-            fatal_error("cannot add int item to attribute table"); \
-    } while(0)
-#define ADD_STR_ATTRIB(node, name, str) do { \
-        if(add_node_attrib(node, name, str, strlen(str)+1) != AST_NO_ERROR) \
-            fatal_error("cannot add string item to attribute table"); \
-    }while(0)
-
-ast_node_t* create_node(int type);
-void destroy_node(ast_node_t*);
-void destroy_ast(ast_node_t* root);
-
-int add_node_attrib(ast_node_t*, int, void*, size_t);
-int get_node_attrib(ast_node_t*, int, void*, size_t);
-
-void add_ast_node(ast_node_t*, ast_node_t*);
-ast_node_t* get_member_list(ast_node_t*);
-void reset_member_list(ast_node_t*);
-ast_node_t* next_member(ast_node_t*);
+#define HAS_NODE_ATTR(node, type) (((node)->attr_mask >> AST_ATTR_SLOT(type)) & 1)
+
+/*
+ * Everything that one compilation builds. The tree is released all at once
+ * with destroy_ast().
+ */
+typedef struct _ast {
+    arena_t* arena;
+    ast_node_t* root;
+    size_t num_nodes;
+    hash_table_t* exports;  // the export table of each imported module
+} ast_t;
+
+ast_t* create_ast(void);
+void destroy_ast(ast_t* ast);
+ast_node_t* create_node(ast_t* ast, int type);
+const char* ast_strndup(ast_t* ast, const char* str, size_t len);
+void set_node_str(ast_node_t* node, int type, const char* str);
+void set_node_num(ast_node_t* node, int type, int num);
+const char* get_node_str(ast_node_t* node, int type);
+int get_node_num(ast_node_t* node, int type);
+const char* get_node_name(ast_node_t* node);
+void add_ast_node(ast_t* ast, ast_node_t* parent, ast_node_t* node);
 int get_node_type(ast_node_t* node);
 const ast_attr_map_t* attr_type_map(int type);
 const ast_attr_map_t* attr_name_map(const char* name);
-size_t get_node_attr_size(ast_node_t* node, int type);
+
+/*
+ * A walk of a tree that keeps its place in a stack of its own instead of in
+ * the nodes or on the C stack. Any number of walks can go over the same tree
+ * at once, and the tree is only read. Every node is entered before its
+ * children and left after them.
+ */
+typedef enum {
+    AST_WALK_END,
+    AST_WALK_ENTER,
+    AST_WALK_LEAVE,
+} ast_walk_event_t;
+
+typedef struct {
+    ast_node_t* node;
+    uint32_t next_child;
+} ast_walk_frame_t;
+
+typedef struct {
+    ast_walk_frame_t* stack;    // the current node is on the top
+    uint32_t depth;
+    uint32_t max_depth;
+    ast_node_t* root;
+    int started;
+    int leaving;                // the top is popped by the next step
+} ast_cursor_t;
+
+void init_ast_cursor(ast_cursor_t* cur, ast_node_t* root);
+void free_ast_cursor(ast_cursor_t* cur);
+ast_walk_event_t next_ast_event(ast_cursor_t* cur, ast_node_t** node);
+ast_node_t* next_ast_node(ast_cursor_t* cur);
+void skip_ast_children(ast_cursor_t* cur);
+ast_node_t* get_ast_parent(ast_cursor_t* cur);
+uint32_t get_ast_depth(ast_cursor_t* cur);
+
+/*
+ * What a visitor returns for a node. Skipping only means something when the
+ * node is entered.
+ */
+typedef enum {
+    AST_VISIT_CONTINUE,
+    AST_VISIT_SKIP,     // do not go into the children
+    AST_VISIT_STOP,     // end the walk
+} ast_visit_result_t;
+
+typedef ast_visit_result_t (*ast_visit_func_t)(ast_node_t* node, ast_node_t* parent, void* data);
+
+int walk_ast(ast_node_t* root, ast_visit_func_t pre, ast_visit_func_t post, void* data);
 
 void dump_ast(ast_node_t* root, const char* file);
 
+/*
+ * The names that an imported module defines, looked up by the name of the
+ * module and the name in it. See exports.c.
+ */
+void add_exports(ast_t* ast, ast_node_t* import);
+hash_table_t* get_exports(ast_t* ast, atom_t module);
+ast_node_t* find_export(ast_t* ast, atom_t module, atom_t name);
+void destroy_exports(ast_t* ast);
+
 #endif
@@ -0,0 +1,21 @@
+#ifndef __ATOMS_H__
+#define __ATOMS_H__
+
+/*
+ * An atom is a string that is kept once for the whole program. Interning the
+ * same text twice gives the same pointer, so two atoms are the same name when
+ * they are the same pointer, and strcmp() is never needed to tell. An atom is
+ * terminated and can be used as a string anywhere. It is good until
+ * destroy_atoms() is called.
+ */
+typedef const char* atom_t;
+
+atom_t intern_atom(const char* str, size_t len);
+atom_t intern_string(const char* str);
+atom_t find_atom(const char* str, size_t len);
+uint32_t atom_hash(atom_t atom);
+size_t atom_length(atom_t atom);
+size_t num_atoms(void);
+void destroy_atoms(void);
+
+#endif
@@ -2,6 +2,7 @@
 #define __COMMON_H__
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -10,17 +11,24 @@
 #include <unistd.h>
 
 #include "misc.h"
+#include "file_map.h"
+#include "source_map.h"
+#include "atoms.h"
 #include "scanner.h"
 #include "memory.h"
+#include "arena.h"
 #include "errors.h"
 #include "hash_table.h"
+#include "swiss_table.h"
 #include "ptr_lists.h"
 #include "data_lists.h"
 #include "stacks.h"
 #include "ast.h"
+#include "flat_ast.h"
 #include "parser.h"
 #include "configure.h"
 #include "symbol_table.h"
+#include "scope_table.h"
 
 extern memory_system_t* memory_system;
 
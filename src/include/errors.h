@@ -9,9 +9,10 @@
  */
 
 void init_errors(int level, FILE* fp);
+scanner_t* set_error_scanner(scanner_t* scan);
 void syntax(char* str, ...);
-int expect_token(scanner_state_t*ss, int expect);
-int expect_token_list(scanner_state_t* ss, int num, ...);
+int expect_token(scanner_t* scan, token_slice_t* tok, int expect);
+int expect_token_list(scanner_t* scan, token_slice_t* tok, int num, ...);
 void scanner_error(char* str, ...);
 void warning(char* str, ...);
 void debug(int level, char* str, ...);
@@ -0,0 +1,21 @@
+#ifndef __FILE_MAP_H__
+#define __FILE_MAP_H__
+
+/*
+ * Number of zero bytes that follow the text of a mapped file. Flex needs two
+ * of them to scan a buffer in place, and the fast scanner loads up to 32
+ * bytes at a time starting anywhere in the text.
+ */
+#define FILE_MAP_PAD 64
+
+typedef struct {
+    char* base;     // the text of the file followed by FILE_MAP_PAD zeros
+    size_t size;    // size of the file
+    size_t length;  // size of the mapping or allocation
+    int mapped;     // non-zero if the text is mapped rather than read
+} file_map_t;
+
+int map_file(file_map_t* fm, const char* fname, int use_mmap);
+void unmap_file(file_map_t* fm);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef __FLAT_AST_H__
+#define __FLAT_AST_H__
+
+/*
+ * The AST kept in flat arrays, one entry per node, in pre-order. A node is an
+ * index into the arrays, so the parent of a node always comes before it and a
+ * pass over every node reads the arrays from the start to the end.
+ *
+ * The root is node 0. Because the root is nobody's child or sibling, 0 is
+ * also what first_child and next_sibling hold when there is none.
+ */
+typedef uint32_t ast_index_t;
+
+#define NO_AST_INDEX 0
+
+/*
+ * The parts of a node that not every node has. Strings are offsets into the
+ * string pool, where offset 0 is the empty string. Payload 0 is all zero and
+ * is shared by every node that has none.
+ */
+typedef struct {
+    uint32_t name;
+    uint32_t type_name;
+    uint16_t data_type;
+    uint16_t ptr_depth;
+} flat_payload_t;
+
+typedef struct {
+    uint8_t* kind;              // the ast_node_types_t of the node
+    ast_index_t* first_child;
+    ast_index_t* next_sibling;
+    source_loc_t* loc;
+    uint32_t* payload;          // index into payloads
+    uint32_t count;             // number of nodes
+
+    flat_payload_t* payloads;
+    uint32_t num_payloads;
+
+    char* strings;
+    uint32_t strings_len;
+
+    void* map;                  // the file that the arrays are in, if mapped
+    size_t map_len;
+} flat_ast_t;
+
+/*
+ * Change this when the node types, the attributes, or the layout of a saved
+ * tree change, so that the files already saved are not used.
+ */
+#define FLAT_AST_VERSION 1
+
+flat_ast_t* flatten_ast(ast_t* ast);
+flat_ast_t* flatten_module(ast_node_t* node, source_loc_t base);
+void destroy_flat_ast(flat_ast_t* flat);
+size_t flat_ast_size(flat_ast_t* flat);
+
+void expand_flat_node(flat_ast_t* flat, ast_index_t idx, ast_node_t* node, ast_t* ast);
+void graft_flat_ast(ast_t* ast, ast_node_t* parent, flat_ast_t* flat, source_loc_t base);
+
+int save_flat_ast(flat_ast_t* flat, const char* fname, uint64_t hash, uint64_t size);
+flat_ast_t* map_flat_ast(const char* fname, uint64_t hash, uint64_t size);
+
+const char* flat_node_name(flat_ast_t* flat, ast_index_t node);
+const char* flat_node_type_name(flat_ast_t* flat, ast_index_t node);
+int flat_node_data_type(flat_ast_t* flat, ast_index_t node);
+int flat_node_ptr_depth(flat_ast_t* flat, ast_index_t node);
+
+void dump_flat_ast(flat_ast_t* flat, const char* file);
+
+#endif
@@ -10,25 +10,72 @@ enum
     HASH_DATA_SIZE,
 };
 
+/*
+ * Data that is no bigger than this is kept in the entry itself instead of
+ * being allocated.
+ */
+#define HASH_INLINE_SIZE 16
+
+/*
+ * An entry with no key is empty, unless its data is the tombstone that a
+ * removed entry leaves behind so that the entries after it can still be found.
+ */
 typedef struct
 {
     const char* key;
-    size_t size;
-    void* data;
+    union
+    {
+        void* data;                     // size > HASH_INLINE_SIZE
+        char bytes[HASH_INLINE_SIZE];   // size <= HASH_INLINE_SIZE
+    } value;
+    uint32_t size;
+    uint32_t hash;  // of the key, so it is not worked out again
 } _table_entry_t;
 
 typedef struct
 {
-    size_t count;
+    size_t count;       // entries with a key
+    size_t tombstones;  // entries that were removed
     size_t capacity;
     _table_entry_t* entries;
+    int atom_keys;      // the keys are atoms and are not copied
+    size_t iter;        // where iterate_hash_table() is
 } hash_table_t;
 
+/*
+ * A place in a walk over the entries of a table. Any number of cursors can
+ * walk the same table at once, as long as the table is not changed while they
+ * do. The key and the data point into the table and are not copies.
+ */
+typedef struct
+{
+    const char* key;
+    void* data;
+    size_t size;
+    size_t index;   // the next slot to look at
+} hash_cursor_t;
+
+uint32_t make_hash(const char* key);
 hash_table_t* create_hash_table(void);
+hash_table_t* create_atom_hash_table(void);
 void destroy_hash_table(hash_table_t* table);
 int insert_hash_table(hash_table_t* table, const char* key, void* data, size_t size);
 int find_hash_table(hash_table_t* table, const char* key, void* data, size_t size);
+void* find_hash_table_data(hash_table_t* table, const char* key);
+int remove_hash_table(hash_table_t* table, const char* key);
 size_t find_hash_table_entry_size(hash_table_t* tab, const char* key);
 const char* iterate_hash_table(hash_table_t* tab, int reset);
+void init_hash_cursor(hash_cursor_t* cur);
+int next_hash_entry(hash_table_t* tab, hash_cursor_t* cur);
+
+/*
+ * Tables that hold pointers into an arena, such as to the nodes of a tree, can
+ * be watched. When an arena is retired in a build with _ARENA_QUARANTINE, the
+ * watched tables are searched for anything that still points into it. In
+ * other builds watching a table does nothing.
+ */
+void watch_hash_table(hash_table_t* tab, pthread_mutex_t* lock);
+void unwatch_hash_table(hash_table_t* tab);
+void check_watched_tables(int (*inside)(const void* ptr, void* ctx), void* ctx);
 
 #endif
@@ -1,7 +1,6 @@
 #ifndef __PARSER_H__
 #define __PARSER_H__
 
-ast_node_t* parse(const char* name);
-void parse_module(const char* name, ast_node_t* node);
+ast_t* parse(const char* name);
 
 #endif
@@ -16,15 +16,30 @@
 // void yyerror(char *s, ...);
 // void yyerror(const char* s);
 
-typedef struct _scanner_state {
-    int token;
-    union __attribute__((packed)) {
+/*
+ * A token is a slice of the input text. The text of the token is not copied,
+ * it points into the text of the file that the scanner is reading from and is
+ * good until that file is closed. Literal values are decoded when the token is
+ * scanned, and the text of a string literal is kept until the scanner is
+ * destroyed. An identifier is interned as an atom. This is small enough to pass around by value.
+ */
+typedef struct {
+    int kind;           // the token_t of the token
+    uint32_t offset;    // offset of the first character of the token in the file
+    uint32_t length;    // number of characters in the token text
+    const char* text;   // the token text in the scan buffer, not terminated
+    source_loc_t loc;   // where the token starts, see source_map.h
+    union {
         int64_t inum;
         uint64_t unum;
         double fnum;
-        char str[1024];
+        struct {
+            const char* ptr;
+            size_t len;
+        } str;          // string literal with the escapes decoded
+        atom_t atom;    // identifier
     } value;
-} scanner_state_t;
+} token_slice_t;
 
 #define FIRST_TOKEN 256
 
@@ -87,11 +102,23 @@ typedef enum {
 
 } token_t ;
 
-char* get_file_name(void);
-int get_line_number(void);
-int get_col_number(void);
-void open_file(const char* fname);
-int get_token(scanner_state_t* ss);
+/*
+ * The scanner is an object so that more than one can be running at the same
+ * time. It is defined in scanner.l.
+ */
+typedef struct _scanner scanner_t;
+
+scanner_t* create_scanner(void);
+void destroy_scanner(scanner_t* scan);
+const char* get_file_name(scanner_t* scan);
+int get_line_number(scanner_t* scan);
+int get_col_number(scanner_t* scan);
+void open_file(scanner_t* scan, const char* fname);
+void close_file(scanner_t* scan);
+source_loc_t get_source_loc(scanner_t* scan);
+token_slice_t get_token(scanner_t* scan);
+token_slice_t peek_token(scanner_t* scan, int k);
+void unget_token(scanner_t* scan, token_slice_t* tok);
 const char* tok_to_strg(int tok);
 
 #endif /* _SCANNER_H_ */
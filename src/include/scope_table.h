@@ -0,0 +1,30 @@
+#ifndef __SCOPE_TABLE_H__
+#define __SCOPE_TABLE_H__
+
+/*
+ * The names that are seen from inside nested scopes, such as the functions in
+ * a function or a struct. There is one table for all of the scopes. A name
+ * that is added in an inner scope hides the one from an outer scope, and the
+ * outer one is put back when the inner scope is popped. So a name is found
+ * with one look up however deep the scopes are.
+ */
+typedef struct {
+    ast_node_t* node;
+    uint32_t depth;         // the scope that the name was added in
+} scope_binding_t;
+
+typedef struct {
+    hash_table_t* names;    // the binding of each name that is seen now
+    data_list_t* undo;      // the bindings that were replaced, to put back
+    data_list_t* marks;     // where the undo log was when each scope was pushed
+    uint32_t depth;         // 0 is the outermost scope
+} scope_table_t;
+
+scope_table_t* create_scope_table(void);
+void destroy_scope_table(scope_table_t* table);
+void push_scope(scope_table_t* table);
+void pop_scope(scope_table_t* table);
+int add_scoped_symbol(scope_table_t* table, atom_t name, ast_node_t* node);
+ast_node_t* find_scoped_symbol(scope_table_t* table, atom_t name);
+
+#endif
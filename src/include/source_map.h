@@ -0,0 +1,22 @@
+#ifndef __SOURCE_MAP_H__
+#define __SOURCE_MAP_H__
+
+/*
+ * A location in the source is one 32 bit number. Every file that is opened
+ * gets its own range of numbers, one for each character and one for the end
+ * of the file, so the location says both the file and the offset in it. The
+ * line and column are only worked out when they are asked for.
+ *
+ * Zero is not a location, and is used for things that do not have one.
+ */
+typedef uint32_t source_loc_t;
+
+#define NO_SOURCE_LOC ((source_loc_t)0)
+
+source_loc_t add_source_file(const void* owner, const char* name, const char* text, size_t size);
+void index_source_lines(source_loc_t base);
+void keep_source_text(source_loc_t base, file_map_t* text);
+void release_source_files(const void* owner);
+int get_source_location(source_loc_t loc, const char** name, int* line, int* col);
+
+#endif
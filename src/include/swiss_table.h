@@ -0,0 +1,35 @@
+#ifndef __SWISS_TABLE_H__
+#define __SWISS_TABLE_H__
+
+/*
+ * A hash table that probes 16 slots at a time. Each slot has a control byte
+ * that says if it is empty, deleted, or full, and when it is full holds 7 bits
+ * of the hash of its key. A probe compares the control bytes of a whole group
+ * of slots to the hash at once, and only looks at the slots that match, so it
+ * stays fast when the table is nearly full.
+ *
+ * The entries, the return values, and the cursors are the same as those of
+ * hash_table.h.
+ */
+typedef struct
+{
+    size_t count;       // entries with a key
+    size_t deleted;     // slots that were removed
+    size_t capacity;    // always a power of 2, and at least a group
+    int8_t* ctrl;       // capacity bytes, then the first group again
+    _table_entry_t* entries;
+    size_t iter;        // where iterate_swiss_table() is
+    int atom_keys;      // the keys are atoms and are not copied
+} swiss_table_t;
+
+swiss_table_t* create_swiss_table(void);
+swiss_table_t* create_atom_swiss_table(void);
+void destroy_swiss_table(swiss_table_t* table);
+int insert_swiss_table(swiss_table_t* table, const char* key, void* data, size_t size);
+int find_swiss_table(swiss_table_t* table, const char* key, void* data, size_t size);
+int remove_swiss_table(swiss_table_t* table, const char* key);
+size_t find_swiss_table_entry_size(swiss_table_t* table, const char* key);
+const char* iterate_swiss_table(swiss_table_t* table, int reset);
+int next_swiss_entry(swiss_table_t* table, hash_cursor_t* cur);
+
+#endif
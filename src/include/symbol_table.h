@@ -1,21 +1,31 @@
 #ifndef __SYMBOL_TABLE_H__
 #define __SYMBOL_TABLE_H__
 
-enum {
+typedef enum {
     ST_NO_ERROR,
     ST_ERROR,
     ST_SYMBOL_EXISTS,
     ST_NOT_FOUND,
 } symbol_table_error_t;
 
-typedef hash_table_t* symbol_table_t;
+/*
+ * The table can be used by more than one thread at once. Adding a name that
+ * is already there gives ST_SYMBOL_EXISTS to every thread but the one that
+ * added it first.
+ */
+typedef struct _symbol_table_t* symbol_table_t;
 
 symbol_table_t create_symbol_table(void);
 void destroy_symbol_table(symbol_table_t table);
+void set_symbol_exports(symbol_table_t table, ast_t* ast);
 
 int add_symbol(symbol_table_t table, const char* name, ast_node_t* node);
+int add_atom_symbol(symbol_table_t table, atom_t name, ast_node_t* node);
 int peek_symbol(symbol_table_t table, const char* name);
+int peek_atom_symbol(symbol_table_t table, atom_t name);
 ast_node_t* get_symbol_reference(symbol_table_t table, const char* name);
+ast_node_t* get_atom_symbol(symbol_table_t table, atom_t name);
 ast_node_t* get_symbol_definition(symbol_table_t table, const char* name);
+size_t num_symbols(symbol_table_t table);
 
 #endif
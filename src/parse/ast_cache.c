@@ -0,0 +1,132 @@
+/*
+ * Modules that are saved between runs.
+ *
+ * When a directory is given for them, every module that is parsed is saved
+ * there as a flat AST, under a hash of its text. The next time a module with
+ * the same text is opened, the saved tree is mapped and put back into the AST
+ * instead of the module being parsed again.
+ *
+ * A module is saved without the modules that it imports. Those are saved on
+ * their own, and when a module is put back, its imports are opened again by
+ * name. So when an imported module changes, only that module is parsed again,
+ * and the modules that import it never hold an old copy of it.
+ */
+#include <sys/stat.h>
+
+#include "common.h"
+#include "internal.h"
+
+static void module_file_name(char* buf, size_t len, const char* dir, uint64_t hash) {
+
+    snprintf(buf, len, "%s/%016lx.ast", dir, (unsigned long)hash);
+}
+
+/*
+ * A saved module is only used if every module that it imports can still be
+ * found. Otherwise it is parsed, so that the error is shown where it is. The
+ * paths that are found are given back in the order of the imports, so they
+ * are not searched for again when the imports are opened.
+ */
+static int find_imports(flat_ast_t* flat, char*** paths, uint32_t* count) {
+
+    uint32_t num = 0;
+
+    *paths = NULL;
+    *count = 0;
+    for(ast_index_t c = flat->first_child[0]; c != NO_AST_INDEX; c = flat->next_sibling[c])
+        num += flat->kind[c] == IMPORT_NODE;
+    if(num == 0)
+        return 1;
+
+    *paths = MALLOC(num * sizeof(char*));
+    for(ast_index_t c = flat->first_child[0]; c != NO_AST_INDEX; c = flat->next_sibling[c]) {
+        if(flat->kind[c] == IMPORT_NODE) {
+            const char* name = flat_node_name(flat, c);
+            char* fn = (name != NULL)? find_import_file(name): NULL;
+            if(fn == NULL) {
+                for(uint32_t i = 0; i < *count; i++)
+                    FREE((*paths)[i]);
+                FREE(*paths);
+                *paths = NULL;
+                *count = 0;
+                return 0;
+            }
+            (*paths)[(*count)++] = fn;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Put the module at the path into node if it was saved. Returns 0 if it was,
+ * or -1 if the module has to be parsed. The key is set either way, so that
+ * the module can be saved after it is parsed. When -1 is returned, the text
+ * is left in the key for the scanner to take, so it is not read again.
+ */
+int load_module(parser_state_t* ps, const char* infile, ast_node_t* node, module_key_t* key) {
+
+    char fname[1024];
+    char** paths;
+    uint32_t num_paths;
+
+    memset(key, 0, sizeof(module_key_t));
+    if(map_file(&key->text, infile, !GET_CONFIG_BOOL("NO_MMAP")))
+        return -1; // open_file() says what is wrong
+
+    key->hash = hash_text(key->text.base, key->text.size);
+    key->size = key->text.size;
+    key->valid = 1;
+
+    module_file_name(fname, sizeof(fname), ps->cache_dir, key->hash);
+    flat_ast_t* flat = map_flat_ast(fname, key->hash, key->size);
+    if(flat == NULL || !find_imports(flat, &paths, &num_paths)) {
+        destroy_flat_ast(flat);
+        return -1;
+    }
+
+    // the text is kept for finding the lines in it, if that is ever needed
+    source_loc_t base = add_source_file(ps->ast, infile, key->text.base, key->text.size);
+    keep_source_text(base, &key->text);
+
+    uint32_t first = node->num_children;
+    graft_flat_ast(ps->ast, node, flat, base);
+    DEBUG("loaded %u nodes of \"%s\" from \"%s\"", flat->count, infile, fname);
+    destroy_flat_ast(flat);
+
+    // the imports are opened the same way that parse_import() opens them
+    uint32_t next = 0;
+    for(uint32_t i = first; i < node->num_children; i++) {
+        ast_node_t* n = node->children[i];
+        if(n->node_type == IMPORT_NODE) {
+            char* path = (next < num_paths)? paths[next++]: NULL;
+            parse_module(ps, get_node_str(n, IMPORT_NAME_ATTR), path, n);
+            add_exports(ps->ast, n);
+        }
+    }
+    for(; next < num_paths; next++)
+        FREE(paths[next]);
+    if(paths != NULL)
+        FREE(paths);
+
+    return 0;
+}
+
+/*
+ * Save a module that was just parsed into node. The base is the location of
+ * the start of its text. Not being able to save it is not an error.
+ */
+void save_module(parser_state_t* ps, ast_node_t* node, source_loc_t base, module_key_t* key) {
+
+    char fname[1024];
+
+    if(!key->valid)
+        return;
+
+    mkdir(ps->cache_dir, 0777);
+    module_file_name(fname, sizeof(fname), ps->cache_dir, key->hash);
+
+    flat_ast_t* flat = flatten_module(node, base);
+    if(!save_flat_ast(flat, fname, key->hash, key->size))
+        DEBUG("saved %u nodes to \"%s\"", flat->count, fname);
+    destroy_flat_ast(flat);
+}
@@ -0,0 +1,662 @@
+/*
+ * Hand written scanner that returns the same tokens as scanner.l.
+ *
+ * The runs of characters that make up most of the input, such as white space,
+ * comments, names, numbers, and the insides of strings, are scanned 16 or 32
+ * characters at a time with SSE2 or AVX2. There is a scalar version of each
+ * of those for other machines.
+ *
+ * The text of every file is followed by FILE_MAP_PAD zero bytes, so a vector
+ * load that starts before the end of the text never reads past the padding.
+ * None of the run scanners stop on a zero byte, so they all take a length and
+ * clip the result to it.
+ */
+#include "common.h"
+#include "internal.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define USE_X86_SIMD
+#  include <immintrin.h>
+#endif
+
+/*
+ * Character classes. A character can be more than one of these.
+ */
+#define CC_SPACE    0x01    // white space other than a newline
+#define CC_IDENT    0x02    // can be in a name after the first character
+#define CC_FIRST    0x04    // can start a name
+#define CC_DIGIT    0x08
+#define CC_HEX      0x10
+
+static uint8_t char_class[256];
+static volatile int classes_ready = 0;
+
+static void init_char_class(void) {
+
+    uint8_t tab[256];
+
+    memset(tab, 0, sizeof(tab));
+    tab[' '] = tab['\t'] = tab['\v'] = tab['\f'] = tab['\r'] = CC_SPACE;
+    for(int c = 'a'; c <= 'z'; c++)
+        tab[c] = CC_IDENT | CC_FIRST;
+    for(int c = 'A'; c <= 'Z'; c++)
+        tab[c] = CC_IDENT | CC_FIRST;
+    for(int c = '0'; c <= '9'; c++)
+        tab[c] = CC_IDENT | CC_DIGIT | CC_HEX;
+    for(int c = 'a'; c <= 'f'; c++) {
+        tab[c] |= CC_HEX;
+        tab[c - 'a' + 'A'] |= CC_HEX;
+    }
+    tab['_'] = CC_IDENT | CC_FIRST;
+    tab['.'] = CC_IDENT;
+
+    // every thread that gets here writes the same thing
+    memcpy(char_class, tab, sizeof(tab));
+    __atomic_store_n(&classes_ready, 1, __ATOMIC_RELEASE);
+}
+
+#define IS(c, cls) (char_class[(uint8_t)(c)] & (cls))
+
+/*
+ * Scalar versions of the run scanners. These are also used to finish a run
+ * when there are fewer characters left than a vector holds.
+ */
+static size_t skip_space_scalar(const char* p, size_t n) {
+
+    size_t i = 0;
+    while(i < n && IS(p[i], CC_SPACE))
+        i++;
+    return i;
+}
+
+static size_t scan_ident_scalar(const char* p, size_t n) {
+
+    size_t i = 0;
+    while(i < n && IS(p[i], CC_IDENT))
+        i++;
+    return i;
+}
+
+static size_t scan_digits_scalar(const char* p, size_t n) {
+
+    size_t i = 0;
+    while(i < n && IS(p[i], CC_DIGIT))
+        i++;
+    return i;
+}
+
+static size_t find_string_end_scalar(const char* p, size_t n, char quote) {
+
+    size_t i = 0;
+    while(i < n && p[i] != quote && p[i] != '\\' && p[i] != '\n')
+        i++;
+    return i;
+}
+
+static size_t find_line_end_scalar(const char* p, size_t n) {
+
+    const char* s = memchr(p, '\n', n);
+    return (s != NULL)? (size_t)(s - p): n;
+}
+
+/*
+ * Returns the index just past the closing "*" "/" or n if there is not one.
+ */
+static size_t find_comment_end_scalar(const char* p, size_t n) {
+
+    for(size_t i = 0; i + 1 < n; i++) {
+        if(p[i] == '*' && p[i+1] == '/')
+            return i + 2;
+    }
+    return n;
+}
+
+static const fast_scan_ops_t scalar_ops = {
+    skip_space_scalar,
+    scan_ident_scalar,
+    scan_digits_scalar,
+    find_string_end_scalar,
+    find_line_end_scalar,
+    find_comment_end_scalar,
+};
+
+#ifdef USE_X86_SIMD
+
+static inline int first_bit(uint32_t mask) { return __builtin_ctz(mask); }
+
+/*
+ * SSE2 versions. Each one builds a mask of the characters that end the run,
+ * then the first set bit is where the run stops.
+ */
+
+// bytes of v that are in [lo, lo+span]
+static inline __m128i in_range_sse2(__m128i v, char lo, char span) {
+
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(span)), d);
+}
+
+static size_t skip_space_sse2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        // ' ', and '\t' through '\r', which takes in '\n'
+        __m128i sp = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), in_range_sse2(v, '\t', '\r' - '\t'));
+        uint32_t stop = ~_mm_movemask_epi8(sp) & 0xffff;
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+static inline uint32_t ident_mask_sse2(__m128i v) {
+
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i m = _mm_or_si128(in_range_sse2(lower, 'a', 'z' - 'a'), in_range_sse2(v, '0', 9));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    return _mm_movemask_epi8(m);
+}
+
+static size_t scan_ident_sse2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 16) {
+        uint32_t stop = ~ident_mask_sse2(_mm_loadu_si128((const __m128i*)(p + i))) & 0xffff;
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+static size_t scan_digits_sse2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        uint32_t stop = ~_mm_movemask_epi8(in_range_sse2(v, '0', 9)) & 0xffff;
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+static size_t find_string_end_sse2(const char* p, size_t n, char quote) {
+
+    for(size_t i = 0; i < n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quote)), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        uint32_t stop = _mm_movemask_epi8(m);
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+static size_t find_line_end_sse2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        uint32_t stop = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+static size_t find_comment_end_sse2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        uint32_t stars = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+
+        for(; stars != 0; stars &= stars - 1) {
+            size_t k = i + first_bit(stars);
+            if(k + 1 >= n)
+                return n;
+            if(p[k + 1] == '/')
+                return k + 2;
+        }
+    }
+    return n;
+}
+
+static const fast_scan_ops_t sse2_ops = {
+    skip_space_sse2,
+    scan_ident_sse2,
+    scan_digits_sse2,
+    find_string_end_sse2,
+    find_line_end_sse2,
+    find_comment_end_sse2,
+};
+
+/*
+ * AVX2 versions. These are the same as the SSE2 ones with twice the width.
+ * They are compiled for AVX2 no matter what the rest of the build targets
+ * and are only used if the CPU has it.
+ */
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 static inline __m256i in_range_avx2(__m256i v, char lo, char span) {
+
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(span)), d);
+}
+
+AVX2 static size_t skip_space_avx2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i sp = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), in_range_avx2(v, '\t', '\r' - '\t'));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(sp);
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+AVX2 static size_t scan_ident_avx2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i m = _mm256_or_si256(in_range_avx2(lower, 'a', 'z' - 'a'), in_range_avx2(v, '0', 9));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(m);
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+AVX2 static size_t scan_digits_avx2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        uint32_t stop = ~(uint32_t)_mm256_movemask_epi8(in_range_avx2(v, '0', 9));
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+AVX2 static size_t find_string_end_avx2(const char* p, size_t n, char quote) {
+
+    for(size_t i = 0; i < n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(quote)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        uint32_t stop = _mm256_movemask_epi8(m);
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+AVX2 static size_t find_line_end_avx2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        uint32_t stop = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        if(stop)
+            return (i + first_bit(stop) < n)? i + first_bit(stop): n;
+    }
+    return n;
+}
+
+AVX2 static size_t find_comment_end_avx2(const char* p, size_t n) {
+
+    for(size_t i = 0; i < n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        uint32_t stars = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('*')));
+
+        for(; stars != 0; stars &= stars - 1) {
+            size_t k = i + first_bit(stars);
+            if(k + 1 >= n)
+                return n;
+            if(p[k + 1] == '/')
+                return k + 2;
+        }
+    }
+    return n;
+}
+
+static const fast_scan_ops_t avx2_ops = {
+    skip_space_avx2,
+    scan_ident_avx2,
+    scan_digits_avx2,
+    find_string_end_avx2,
+    find_line_end_avx2,
+    find_comment_end_avx2,
+};
+
+#endif /* USE_X86_SIMD */
+
+/*
+ * Pick the widest set of run scanners that this CPU can use.
+ */
+const fast_scan_ops_t* select_fast_scan_ops(void) {
+
+    if(!__atomic_load_n(&classes_ready, __ATOMIC_ACQUIRE))
+        init_char_class();
+
+#ifdef USE_X86_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return &avx2_ops;
+    if(__builtin_cpu_supports("sse2"))
+        return &sse2_ops;
+#endif
+    return &scalar_ops;
+}
+
+#define NO_END ((size_t)-1)
+
+/*
+ * Keywords, and the operators that are spelled as words. A name is only a
+ * keyword if the whole thing matches, the same as the longest match that flex
+ * does.
+ */
+typedef struct {
+    const char* str;
+    int tok;
+} keyword_t;
+
+static const keyword_t keywords[] = {
+    {"import", IMPORT}, {"extern", EXTERN}, {"const", CONST}, {"static", STATIC},
+    {"typedef", TYPEDEF}, {"break", BREAK}, {"continue", CONTINUE}, {"return", RETURN},
+    {"yield", YIELD}, {"switch", SWITCH}, {"case", CASE}, {"default", DEFAULT},
+    {"do", DO}, {"while", WHILE}, {"for", FOR}, {"if", IF}, {"else", ELSE},
+    {"main", MAIN}, {"float", FLOAT}, {"int", INT}, {"uint", UINT}, {"bool", BOOL},
+    {"void", VOID}, {"string", STRING}, {"tuple", TUPLE}, {"struct", STRUCT},
+    {"true", TRUE}, {"false", FALSE}, {"sizeof", SIZEOF}, {"typeof", TYPEOF},
+    {"and", AND_OP}, {"or", OR_OP}, {"le", LE_OP}, {"ge", GE_OP}, {"eq", EQ_OP},
+    {"ne", NE_OP},
+    {NULL, 0}
+};
+
+static int keyword_or_ident(const char* p, size_t len) {
+
+    // no keyword is longer than 8 characters or has a dot or a digit in it
+    if(len <= 8) {
+        for(int i = 0; keywords[i].str != NULL; i++) {
+            if(keywords[i].str[0] == p[0] && !strncmp(keywords[i].str, p, len) && keywords[i].str[len] == '\0')
+                return keywords[i].tok;
+        }
+    }
+    return IDENTIFIER;
+}
+
+/*
+ * The length of a float that starts at p, or zero if it is not one. This is
+ * the same as [-+]?[0-9]+\.[0-9]+([eE]*[-+]?[0-9]+)? in scanner.l.
+ */
+static size_t float_length(const fast_scan_ops_t* ops, const char* p, size_t n) {
+
+    size_t i = 0;
+
+    if(i < n && (p[i] == '-' || p[i] == '+'))
+        i++;
+
+    size_t d = ops->scan_digits(p + i, n - i);
+    if(d == 0)
+        return 0;
+    i += d;
+
+    if(i + 1 >= n || p[i] != '.' || !IS(p[i+1], CC_DIGIT))
+        return 0;
+    i++;
+    i += ops->scan_digits(p + i, n - i);
+
+    // the exponent is only taken if it has digits
+    size_t e = i;
+    while(e < n && (p[e] == 'e' || p[e] == 'E'))
+        e++;
+    if(e < n && (p[e] == '-' || p[e] == '+'))
+        e++;
+    d = ops->scan_digits(p + e, n - e);
+    if(d > 0)
+        i = e + d;
+
+    return i;
+}
+
+/*
+ * Decode the inside of a double quoted string in the same way as the DQUOTES
+ * rules in scanner.l. Returns the index just past the closing quote, or
+ * NO_END if the string does not end.
+ */
+static size_t scan_dquotes(const fast_scan_ops_t* ops, const char* p, size_t n, literal_builder_t* lit) {
+
+    size_t i = 0;
+
+    while(i < n) {
+        size_t k = ops->find_string_end(p + i, n - i, '"');
+        if(k > 0)
+            append_strn(lit, p + i, k);
+        i += k;
+        if(i >= n)
+            break;
+
+        char c = p[i];
+        if(c == '"')
+            return i + 1;
+        else if(c == '\n') {
+            // not part of the string
+            i++;
+        }
+        else if(i + 1 >= n || p[i+1] == '\n') {
+            // a backslash at the end of a line is dropped
+            i++;
+        }
+        else {
+            char e = p[i+1];
+            size_t j;
+
+            switch(e) {
+                case 'n': append_char(lit, '\n'); i += 2; break;
+                case 'r': append_char(lit, '\r'); i += 2; break;
+                case 't': append_char(lit, '\t'); i += 2; break;
+                case 'b': append_char(lit, '\b'); i += 2; break;
+                case 'f': append_char(lit, '\f'); i += 2; break;
+                case 'v': append_char(lit, '\v'); i += 2; break;
+                case 'x':
+                case 'X':
+                    // up to three hex digits, if there are any
+                    for(j = 0; j < 3 && i + 2 + j < n && IS(p[i + 2 + j], CC_HEX); j++)
+                        ;
+                    if(j > 0) {
+                        int v = 0;
+                        for(size_t m = 0; m < j; m++) {
+                            char h = p[i + 2 + m];
+                            v = v * 16 + (IS(h, CC_DIGIT)? h - '0': (h | 0x20) - 'a' + 10);
+                        }
+                        append_char(lit, (char)v);
+                        i += 2 + j;
+                    }
+                    else {
+                        append_char(lit, e);
+                        i += 2;
+                    }
+                    break;
+                default:
+                    // one octal digit is taken as itself, like flex does
+                    for(j = 0; j < 3 && i + 1 + j < n && p[i + 1 + j] >= '0' && p[i + 1 + j] <= '7'; j++)
+                        ;
+                    if(j > 1) {
+                        int v = 0;
+                        for(size_t m = 0; m < j; m++)
+                            v = v * 8 + (p[i + 1 + m] - '0');
+                        append_char(lit, (char)v);
+                        i += 1 + j;
+                    }
+                    else {
+                        append_char(lit, e);
+                        i += 2;
+                    }
+                    break;
+            }
+        }
+    }
+    return NO_END;
+}
+
+/*
+ * Single quoted strings are taken as they are, backslashes and all.
+ */
+static size_t scan_squotes(const fast_scan_ops_t* ops, const char* p, size_t n, literal_builder_t* lit) {
+
+    size_t i = 0;
+
+    while(i < n) {
+        size_t k = ops->find_string_end(p + i, n - i, '\'');
+        if(k > 0)
+            append_strn(lit, p + i, k);
+        i += k;
+        if(i >= n)
+            break;
+
+        char c = p[i];
+        if(c == '\'')
+            return i + 1;
+        else if(c == '\n')
+            i++;
+        else if(i + 1 >= n || p[i+1] == '\n')
+            i++;
+        else {
+            append_strn(lit, p + i, 2);
+            i += 2;
+        }
+    }
+    return NO_END;
+}
+
+#define TWO(c1, c2) (((c1) << 8) | (c2))
+
+/*
+ * Return the operator or punctuation token at p and its length, or zero if
+ * the character is one that the scanner ignores.
+ */
+static int scan_operator(const char* p, size_t n, size_t* len) {
+
+    int pair = (n > 1)? TWO((uint8_t)p[0], (uint8_t)p[1]): 0;
+
+    *len = 2;
+    switch(pair) {
+        case TWO('&', '&'): return AND_OP;
+        case TWO('|', '|'): return OR_OP;
+        case TWO('<', '='): return LE_OP;
+        case TWO('>', '='): return GE_OP;
+        case TWO('=', '='): return EQ_OP;
+        case TWO('!', '='): return NE_OP;
+        case TWO('>', '>'): return RIGHT_OP;
+        case TWO('<', '<'): return LEFT_OP;
+    }
+
+    *len = 1;
+    switch(p[0]) {
+        case '&': case '!': case '~': case '-': case '+': case '*': case '/':
+        case '%': case '<': case '>': case '^': case '|': case '?':
+        case ';': case '{': case '}': case ',': case ':': case '=': case '(':
+        case ')': case '[': case ']':
+            return p[0];
+        case '.':
+            if(n > 2 && p[1] == '.' && p[2] == '.') {
+                *len = 3;
+                return ELLIPSIS;
+            }
+            return '.';
+    }
+    return 0;
+}
+
+/*
+ * Scan the next token in the file. Returns the token, or zero at the end of
+ * the text, the same as yylex(). The file is not closed here.
+ */
+int fast_scan(scanner_t* scan, _file_name_stack* file, literal_builder_t* lit, token_slice_t* tok) {
+
+    const fast_scan_ops_t* ops = scan->ops;
+    const char* text = file->fast_text;
+    size_t size = file->text.size;
+    size_t pos = file->fast_pos;
+    int kind = 0;
+
+    while(kind == 0) {
+        pos += ops->skip_space(text + pos, size - pos);
+        if(pos >= size) {
+            file->fast_pos = size;
+            return 0;
+        }
+
+        const char* p = text + pos;
+        size_t n = size - pos;
+        size_t len = 0;
+        char c = p[0];
+
+        memset(tok, 0, sizeof(token_slice_t));
+
+        if(IS(c, CC_FIRST)) {
+            len = ops->scan_ident(p, n);
+            kind = keyword_or_ident(p, len);
+        }
+        else if(IS(c, CC_DIGIT) || ((c == '-' || c == '+') && n > 1 && IS(p[1], CC_DIGIT))) {
+            if(0 != (len = float_length(ops, p, n))) {
+                kind = FNUM_LITERAL;
+                scan->out_of_range = decode_fnum(p, len, &tok->value.fnum);
+            }
+            else if(c == '0' && n > 2 && (p[1] == 'x' || p[1] == 'X') && IS(p[2], CC_HEX)) {
+                for(len = 2; len < n && IS(p[len], CC_HEX); len++)
+                    ;
+                kind = UNUM_LITERAL;
+                scan->out_of_range = decode_unum(p, len, &tok->value.unum);
+            }
+            else if(IS(c, CC_DIGIT)) {
+                len = ops->scan_digits(p, n);
+                kind = INUM_LITERAL;
+                scan->out_of_range = decode_inum(p, len, &tok->value.inum);
+            }
+            else
+                kind = scan_operator(p, n, &len);
+        }
+        else if(c == '"' || c == '\'') {
+            start_literal(lit);
+            if(c == '"')
+                len = scan_dquotes(ops, p + 1, n - 1, lit);
+            else
+                len = scan_squotes(ops, p + 1, n - 1, lit);
+
+            if(len == NO_END) {
+                // the string did not end before the end of the file
+                file->fast_pos = size;
+                return 0;
+            }
+            len++;
+            kind = STRING_LITERAL;
+            tok->value.str.ptr = lit->buffer;
+            tok->value.str.len = lit->len;
+        }
+        else if(c == '/' && n > 1 && p[1] == '/') {
+            pos += ops->find_line_end(p, n);
+        }
+        else if(c == '/' && n > 1 && p[1] == '*') {
+            pos += 2 + ops->find_comment_end(p + 2, n - 2);
+        }
+        else {
+            kind = scan_operator(p, n, &len);
+            if(kind == 0)
+                pos++;  // ignore characters such as '#'
+        }
+
+        if(kind != 0) {
+            tok->kind = kind;
+            tok->offset = pos;
+            tok->length = len;
+            tok->text = p;
+            pos += len;
+        }
+    }
+
+    file->fast_pos = pos;
+    return kind;
+}
@@ -1,18 +1,197 @@
 #ifndef __INTERNAL_H__
 #define __INTERNAL_H__
 
+/*
+ * The scanner can be run with the flex scanner, with the hand written fast
+ * scanner, or with both of them at once, comparing the tokens that they
+ * return. The fast scanner is in fast_scanner.c.
+ */
+typedef enum {
+    SCAN_FLEX,
+    SCAN_FAST,
+    SCAN_DIFF,
+} scan_backend_t;
+
+/*
+ * A string literal as it is being built. The text is in the scanner's arena
+ * and grows as it is appended to, so there is no limit on the length. When
+ * the string ends, the token points at the text where it is and the next
+ * string is started somewhere else in the arena.
+ */
+typedef struct {
+    arena_t* arena;
+    char* buffer;   // always terminated
+    size_t len;
+    size_t cap;
+} literal_builder_t;
+
+/*
+ * A token as it is kept in the token cache. The text of the token is not kept,
+ * because it is a slice of the source, which is still opened. A string
+ * literal is kept in the string pool that follows the records.
+ */
+typedef struct {
+    uint32_t kind;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t out_of_range;      // the number literal did not fit
+    union {
+        int64_t inum;
+        uint64_t unum;
+        double fnum;
+        struct {
+            uint32_t offset;    // into the string pool
+            uint32_t len;
+        } str;
+    } value;
+} token_record_t;
+
+/*
+ * Change this when the scanner changes what it returns, so that the streams
+ * already in the cache are not used.
+ */
+#define TOKEN_CACHE_VERSION 3
+
+/*
+ * The token stream for one file. It is either being replayed from a cache
+ * file that is mapped, or it is being recorded so that it can be saved when
+ * the end of the file is reached.
+ */
+typedef struct {
+    uint64_t hash;              // of the text and the version
+    void* map;                  // the cache file, when replaying
+    size_t map_len;
+    const token_record_t* recs;
+    const char* pool;
+    uint32_t count;
+    uint32_t pos;               // next record to replay
+    int recording;
+    token_record_t* out;        // records to save
+    uint32_t out_count;
+    uint32_t out_cap;
+    char* out_pool;
+    uint32_t pool_len;
+    uint32_t pool_cap;
+} token_cache_t;
+
+struct yy_buffer_state; // defined by flex
+
+typedef struct _file_name_stack {
+    struct yy_buffer_state* state;  // flex buffer for the text
+    char *name;
+    file_map_t text;
+    uint32_t offset;                // where flex is in the text
+    source_loc_t loc_base;          // location of the first character
+    const char* fast_text;          // text that the fast scanner reads
+    uint32_t fast_pos;              // where the fast scanner is in the text
+    token_cache_t cache;
+    struct _file_name_stack *next;
+} _file_name_stack;
+
+/*
+ * Operations that the fast scanner uses to scan runs of characters. There is
+ * a set for each instruction set and the best one is picked when the scanner
+ * is created.
+ */
+typedef struct {
+    size_t (*skip_space)(const char* p, size_t n);
+    size_t (*scan_ident)(const char* p, size_t n);
+    size_t (*scan_digits)(const char* p, size_t n);
+    size_t (*find_string_end)(const char* p, size_t n, char quote);
+    size_t (*find_line_end)(const char* p, size_t n);
+    size_t (*find_comment_end)(const char* p, size_t n);
+} fast_scan_ops_t;
+
+/*
+ * Tokens that have been scanned but not taken by get_token() yet. This is a
+ * ring, so LOOKAHEAD_SIZE has to be a power of two.
+ */
+#define LOOKAHEAD_SIZE 8
+
+typedef struct {
+    token_slice_t toks[LOOKAHEAD_SIZE];
+    int head;                       // the slot of the next token
+    int count;                      // number of tokens in the ring
+} lookahead_t;
+
+/*
+ * Everything that the scanner knows lives here, so that more than one file
+ * can be scanned at the same time. Files that are opened while one is being
+ * scanned, such as imports, are pushed on the file stack.
+ */
+struct _scanner {
+    void* yyscanner;                // the flex state
+    scan_backend_t backend;
+    const fast_scan_ops_t* ops;     // used by the fast scanner
+    _file_name_stack* files;        // stack of open files
+    token_slice_t token;            // the token that is being scanned
+    arena_t* strings;               // text of the string literals
+    literal_builder_t lit;          // string literal being built
+    literal_builder_t fast_lit;     // for the fast scanner when comparing
+    uint32_t str_offset;            // offset of the opening quote
+    lookahead_t ahead;              // tokens from peek_token() and unget_token()
+    const char* cache_dir;          // where token streams are kept, or NULL
+    const void* source_owner;       // what the files are released with, see source_map.c
+    source_loc_t last_loc;          // of the last token that get_token() gave
+    int out_of_range;               // the number literal that was scanned did not fit
+};
+
+// scanner.l
+void open_found_file(scanner_t* scan, const char* fname, char* infile, file_map_t* text, const uint64_t* hash);
+void start_literal(literal_builder_t* lit);
+void append_char(literal_builder_t* lit, char ch);
+void append_strn(literal_builder_t* lit, const char *str, size_t len);
+
+// fast_scanner.c
+const fast_scan_ops_t* select_fast_scan_ops(void);
+int fast_scan(scanner_t* scan, _file_name_stack* file, literal_builder_t* lit, token_slice_t* tok);
+
+// literals.c
+int decode_inum(const char* text, size_t len, int64_t* val);
+int decode_unum(const char* text, size_t len, uint64_t* val);
+int decode_fnum(const char* text, size_t len, double* val);
+
+// token_cache.c
+uint64_t hash_text(const char* text, size_t size);
+int load_token_cache(token_cache_t* cache, const char* dir, size_t size);
+int replay_token(_file_name_stack* file, arena_t* strings, token_slice_t* tok, int* out_of_range);
+void record_token(token_cache_t* cache, token_slice_t* tok, int out_of_range);
+void save_token_cache(token_cache_t* cache, const char* dir, size_t size);
+void free_token_cache(token_cache_t* cache);
+
+/*
+ * State for one run of the parser. This is passed down to every parse function
+ * so that more than one parse can be running at the same time.
+ */
 typedef struct _parser_state {
-    ast_node_t* node;
-    scanner_state_t* ss;
+    scanner_t* scan;    // the scanner that is reading the module
+    ast_t* ast;         // the tree that the nodes are made in
+    int entered;        // how deeply the imports are nested
+    const char* cache_dir;  // where parsed modules are kept, or NULL
 } parser_state_t;
 
+/*
+ * What a module is saved under in the AST cache.
+ */
+typedef struct {
+    uint64_t hash;      // of the text of the module
+    size_t size;
+    int valid;          // the text was read and hashed
+    file_map_t text;    // the text, until the scanner takes it
+} module_key_t;
+
+// ast_cache.c
+int load_module(parser_state_t* ps, const char* infile, ast_node_t* node, module_key_t* key);
+void save_module(parser_state_t* ps, ast_node_t* node, source_loc_t base, module_key_t* key);
+
 // types.c
-int is_type(scanner_state_t*);
-int is_defined_type(scanner_state_t*);
+int is_type(token_slice_t*);
+int is_defined_type(token_slice_t*);
 
-int parse_import(ast_node_t*);
-int parse_data_or_func_def(ast_node_t*);
-int parse_typedef(ast_node_t*);
+void parse_module(parser_state_t*, const char*, char*, ast_node_t*);
+int parse_import(parser_state_t*, ast_node_t*);
+int parse_data_or_func_def(parser_state_t*, token_slice_t*, ast_node_t*);
+int parse_typedef(parser_state_t*, ast_node_t*);
 
 char* find_import_file(const char* base);
 #endif
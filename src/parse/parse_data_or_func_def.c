@@ -3,81 +3,86 @@
 #include "common.h"
 #include "internal.h"
 
-int parse_expression(ast_node_t* node) {
+int parse_expression(parser_state_t* ps, ast_node_t* node) {
     // TODO move this to its own file
     return 0;
 }
 
-int parse_func_body(ast_node_t* node) {
+int parse_func_body(parser_state_t* ps, ast_node_t* node) {
     // add to own file
     return 0;
 }
 
-int parse_indirection(ast_node_t* node) {
-
-    int count = 1;
-    int finished = 0;
-    int retv = 0;
-    int tok;
-    scanner_state_t ss;
+/*
+ * Read the pointer stars and the name that follow a type. The stars are
+ * counted so the caller can decide what to build before it builds it.
+ */
+static int parse_declarator(parser_state_t* ps, int* ptr_count, token_slice_t* name) {
 
-    while(!finished) {
-        tok = expect_token_list(&ss, 2, '*', IDENTIFIER);
-        if(tok == '*')
-            count ++;
-        else if(tok == IDENTIFIER) {
-            ADD_STR_ATTRIB(node, NAME_ATTR, ss.value.str);
-            ADD_INT_ATTRIB(node, IS_POINTER_ATTR, count);
-            finished ++;
-        }
-        else {
-            retv ++;
-            finished ++;
-        }
+    *ptr_count = 0;
+    while(peek_token(ps->scan, 0).kind == '*') {
+        get_token(ps->scan);
+        (*ptr_count)++;
     }
 
-    return retv;
+    // after the stars, only a name is accepted, but the message is the same
+    if(expect_token_list(ps->scan, name, 2, '*', IDENTIFIER) != IDENTIFIER)
+        return 1;
+
+    return 0;
+}
+
+static void add_declarator(ast_node_t* node, int ptr_count, token_slice_t* name) {
+
+    set_node_str(node, NAME_ATTR, name->value.atom);
+    if(ptr_count > 0)
+        set_node_num(node, IS_POINTER_ATTR, ptr_count);
 }
 
-int parse_func_def_parm_list(ast_node_t* node) {
+static void add_type(ast_node_t* node, token_slice_t* type) {
+
+    if(type->kind == IDENTIFIER)
+        set_node_str(node, TYPE_NAME_ATTR, type->value.atom);
+    set_node_num(node, DATA_TYPE_ATTR, type->kind);
+}
+
+/*
+ * The opening '(' has been read. An empty list is allowed.
+ */
+int parse_func_def_parm_list(parser_state_t* ps, ast_node_t* node) {
 
     int retv = 0;
-    int tok;
-    scanner_state_t ss;
+    int kind;
+    token_slice_t tok;
     int finished = 0;
-    ast_node_t* n;
+    int ptr_count;
+
+    if(peek_token(ps->scan, 0).kind == ')') {
+        get_token(ps->scan);
+        return 0;
+    }
 
     while(!finished) {
-        tok = get_token(&ss);
-        if(is_type(&ss)) {
-            n = create_node(FUNC_PARAM_NODE);
-            if(tok == IDENTIFIER)
-                ADD_STR_ATTRIB(n, TYPE_NAME_ATTR, ss.value.str);
-            ADD_INT_ATTRIB(n, DATA_TYPE_ATTR, tok);
-            add_ast_node(node, n);
-        }
-        else {
-            syntax("expected a type specifier but got %s", tok_to_strg(tok));
-            retv ++;
-            finished ++;
+        tok = get_token(ps->scan);
+        if(!is_type(&tok)) {
+            syntax("expected a type specifier but got %s", tok_to_strg(tok.kind));
+            return retv + 1;
         }
 
-        tok = expect_token_list(&ss, 2, IDENTIFIER, '*');
-        if(tok == '*') {
-            retv += parse_indirection(n);
-        }
-        else if(tok == IDENTIFIER) {
-            ADD_STR_ATTRIB(n, NAME_ATTR, ss.value.str);
-        }
-        else {
-            retv ++;
-        }
+        ast_node_t* n = create_node(ps->ast, FUNC_PARAM_NODE);
+        n->loc = tok.loc;
+        add_type(n, &tok);
+        add_ast_node(ps->ast, node, n);
 
-        tok = expect_token_list(&ss, 2, ',', ')');
-        if(tok == ')') {
+        retv += parse_declarator(ps, &ptr_count, &tok);
+        if(!retv)
+            add_declarator(n, ptr_count, &tok);
+
+        kind = expect_token_list(ps->scan, &tok, 2, ',', ')');
+        if(kind == ')') {
             finished ++;
         }
-        else if(tok == ERROR_TOKEN){
+        else if(kind == ERROR_TOKEN){
             retv ++;
         }
 
@@ -89,53 +94,57 @@ int parse_func_def_parm_list(ast_node_t* node) {
 
 /*
  * A type has been read and it needs to be seen if this is a data definition or
- * if it's a function definition.
+ * if it's a function definition. The node is created once that is known and
+ * added to the parent.
  *
  * type name '='|';' = a data definition
  * type name '(' = a function definition
  */
-int parse_data_or_func_def(ast_node_t* node) {
-
-    scanner_state_t ss;
-    int retv = 0;
-
-    // expect a '*' or a name
-    int tok = expect_token_list(&ss, 2, '*', IDENTIFIER);
-
-    if(tok == '*') {
-        retv += parse_indirection(node);
+int parse_data_or_func_def(parser_state_t* ps, token_slice_t* type, ast_node_t* parent) {
+
+    token_slice_t name;
+    token_slice_t tok;
+    int ptr_count;
+    int node_type = NO_NODE_TYPE;
+
+    int has_name = !parse_declarator(ps, &ptr_count, &name);
+    int kind = ERROR_TOKEN;
+    int retv = has_name? 0: 1;
+
+    if(has_name) {
+        kind = expect_token_list(ps->scan, &tok, 3, '(', '=', ';');
+        if(kind == '(')
+            node_type = FUNC_DEF_PARM_NODE;
+        else if(kind == '=')
+            node_type = EXPRESSION_ASSIGN_NODE;
+        else if(kind == ';')
+            node_type = DATA_DEF_NODE;
+        else
+            retv ++;
     }
-    else if(tok == IDENTIFIER) {
-        ADD_STR_ATTRIB(node, NAME_ATTR, ss.value.str);
-        //add_symbol(ss.value.str, node);
+
+    ast_node_t* node = create_node(ps->ast, node_type);
+    node->loc = type->loc;
+    add_type(node, type);
+    if(has_name)
+        add_declarator(node, ptr_count, &name);
+    add_ast_node(ps->ast, parent, node);
+
+    if(kind == '(') {
+        // parse the parameter list
+        retv += parse_func_def_parm_list(ps, node);
+
+        // parse the function body
+        ast_node_t* n = create_node(ps->ast, FUNC_BODY_NODE);
+        n->loc = get_source_loc(ps->scan);
+        retv += parse_func_body(ps, n);
+        add_ast_node(ps->ast, node, n);
     }
-    else
-        retv ++; // error
-
-    if(!retv) {
-        tok = expect_token_list(&ss, 3, '(', '=', ';');
-        if(tok == '(') {
-            // parse the parameter list
-            node->node_type = FUNC_DEF_PARM_NODE;
-            retv += parse_func_def_parm_list(node);
-
-            // parse the function body
-            ast_node_t* n = create_node(FUNC_BODY_NODE);
-            retv += parse_func_body(n);
-            add_ast_node(node, n);
-        }
-        else if(tok == '=') {
-            node->node_type = EXPRESSION_ASSIGN_NODE;
-            ast_node_t* n = create_node(EXPRESSION_ASSIGN_NODE);
-            retv += parse_expression(n);
-            add_ast_node(node, n);
-        }
-        else if(tok == ';') {
-            node->node_type = DATA_DEF_NODE;
-            return retv; // no more processing here
-        }
-        else
-            return retv + 1; // error
+    else if(kind == '=') {
+        ast_node_t* n = create_node(ps->ast, EXPRESSION_ASSIGN_NODE);
+        n->loc = tok.loc;
+        retv += parse_expression(ps, n);
+        add_ast_node(ps->ast, node, n);
     }
 
     return retv;
@@ -4,7 +4,8 @@
  *
  * The node's name forms the symbol that the node is imported under. Access
  * to symbols defined in this node are accessed using the dot '.' operator with
- * the import symbol as the prefix.
+ * the import symbol as the prefix. Once the module is read, the names that it
+ * defines are put in its export table, see exports.c.
  *
  * This uses the import path that has been specified on the command line, if any.
  * The file extention is added when the file becomes open for parsing. The file
@@ -100,29 +101,29 @@ char* find_import_file(const char* base) {
     return tmp; // caller must free this
 }
 
-int parse_import(ast_node_t* node) {
+int parse_import(parser_state_t* ps, ast_node_t* node) {
 
-    scanner_state_t ss;
-    int tok = get_token(&ss);
+    token_slice_t tok = get_token(ps->scan);
 
-    if(tok == STRING_LITERAL) {
-        ADD_STR_ATTRIB(node, IMPORT_NAME_ATTR, ss.value.str);
-        char* fn = find_import_file(ss.value.str);
+    if(tok.kind == STRING_LITERAL) {
+        set_node_str(node, IMPORT_NAME_ATTR, intern_atom(tok.value.str.ptr, tok.value.str.len));
+        char* fn = find_import_file(tok.value.str.ptr);
         if(fn != NULL) {
-            parse_module(fn, node);
-            free(fn);
+            // take the ';' first so that no lookahead is left in this file
+            expect_token(ps->scan, &tok, ';');
+            // the path that was found is used to open it, and is freed with the file
+            parse_module(ps, get_node_str(node, IMPORT_NAME_ATTR), fn, node);
+            add_exports(ps->ast, node);
         }
         else {
-            syntax("cannot find module \"%s\" to open", ss.value.str);
+            syntax("cannot find module \"%s\" to open", tok.value.str.ptr);
             return 1;
         }
     }
     else {
-        syntax("expected a module name in quotes, but got %s", tok_to_strg(tok));
+        syntax("expected a module name in quotes, but got %s", tok_to_strg(tok.kind));
         return 1;
     }
 
-    expect_token(&ss, ';');
-
     return 0;
 }
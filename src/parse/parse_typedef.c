@@ -2,6 +2,6 @@
 #include "common.h"
 #include "internal.h"
 
-int parse_typedef(ast_node_t* node) {
+int parse_typedef(parser_state_t* ps, ast_node_t* node) {
     return 0;
 }
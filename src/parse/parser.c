@@ -2,53 +2,70 @@
 #include "common.h"
 #include "internal.h"
 
-// This is a guard to prevent recursively importing a file. If it goes over 256, then an
-// error is reported and the compiler aborts compilation.
-static int entered = 0;
-
 /*
  * This function is called recursively when an import statement is encountered.
+ *
+ * The parser state keeps a guard to prevent recursively importing a file. If it
+ * goes over 256, then an error is reported and the compiler aborts compilation.
+ *
+ * If there is an AST cache, a module that was saved there is put back instead
+ * of being parsed, and a module that is parsed is saved there. A module is only
+ * saved if no error or warning came out while it was parsed, so that using the
+ * saved copy never hides one.
+ *
+ * The path of the module is taken if the caller has already found it, or it is
+ * found here. It belongs to the parser after this. The text is read one time,
+ * and the AST cache and the scanner share it.
  */
-void parse_module(const char* name, ast_node_t* node) {
+void parse_module(parser_state_t* ps, const char* name, char* infile, ast_node_t* node) {
 
-    int tok;
+    token_slice_t tok;
     int finished = 0;
-    scanner_state_t ss;
     int err_flag = 0;
+    module_key_t key;
 
-    entered ++;
-    if(entered > 256)
+    ps->entered ++;
+    if(ps->entered > 256)
         fatal_error("import nesting greater than 256 levels is not allowed");
 
-    open_file(name);
+    memset(&key, 0, sizeof(key));
+    if(infile == NULL)
+        infile = find_import_file(name);
+
+    if(ps->cache_dir != NULL && infile != NULL && !load_module(ps, infile, node, &key)) {
+        FREE(infile);
+        ps->entered --;
+        return;
+    }
+
+    int errors = get_num_errors();
+    int warnings = get_num_warnings();
+    // the scanner takes the path, and the text and its hash if the cache read them
+    open_found_file(ps->scan, name, infile, key.valid? &key.text: NULL, key.valid? &key.hash: NULL);
+    source_loc_t base = ps->scan->files->loc_base;
 
     while(!finished) {
-        tok = get_token(&ss);
-        if(tok == IMPORT) {
+        tok = get_token(ps->scan);
+        if(tok.kind == IMPORT) {
             err_flag = 0;
-            ast_node_t* n = create_node(IMPORT_NODE);
-            err_flag += parse_import(n);
-            add_ast_node(node, n);
+            ast_node_t* n = create_node(ps->ast, IMPORT_NODE);
+            n->loc = tok.loc;
+            err_flag += parse_import(ps, n);
+            add_ast_node(ps->ast, node, n);
         }
-        else if(tok == TYPEDEF) {
+        else if(tok.kind == TYPEDEF) {
             err_flag = 0;
-            ast_node_t* n = create_node(TYPEDEF_NODE);
-            err_flag += parse_typedef(n);
-            add_ast_node(node, n);
+            ast_node_t* n = create_node(ps->ast, TYPEDEF_NODE);
+            n->loc = tok.loc;
+            err_flag += parse_typedef(ps, n);
+            add_ast_node(ps->ast, node, n);
         }
-        else if(is_type(&ss)) {
+        else if(is_type(&tok)) {
             err_flag = 0;
-            ast_node_t* n = create_node(NO_NODE_TYPE);
-            // if the type is an identifier....
-            if(tok == IDENTIFIER) {
-                ADD_STR_ATTRIB(n, TYPE_NAME_ATTR, ss.value.str);
-            }
-            ADD_INT_ATTRIB(n, DATA_TYPE_ATTR, tok);
-            // node type is not known yet.
-            err_flag += parse_data_or_func_def(n);
-            add_ast_node(node, n);
+            // the node is created once it is known what it is
+            err_flag += parse_data_or_func_def(ps, &tok, node);
         }
-        else if(tok == END_OF_INPUT || tok == END_OF_FILE) {
+        else if(tok.kind == END_OF_INPUT || tok.kind == END_OF_FILE) {
             finished++;
         }
         else if(get_num_errors() > 20) {
@@ -59,28 +76,46 @@ void parse_module(const char* name, ast_node_t* node) {
             // keep getting tokens without printing errors until an acceptible
             // token is found.
             if(err_flag == 0)
-                syntax("expected import, data definition, or function definition, but got %s (%d)", tok_to_strg(tok), tok);
+                syntax("expected import, data definition, or function definition, but got %s (%d)", tok_to_strg(tok.kind), tok.kind);
             err_flag += 1;
 
         }
     }
-    entered --;
+
+    if(ps->cache_dir != NULL && errors == get_num_errors() && warnings == get_num_warnings())
+        save_module(ps, node, base, &key);
+    ps->entered --;
 }
 
 /*
- * Main entry point for the parser. Returns a pointer to the AST for further processing.
+ * Main entry point for the parser. Returns the AST for further processing. The
+ * caller frees it with destroy_ast().
  */
-ast_node_t* parse(const char* name) {
+ast_t* parse(const char* name) {
+
+    parser_state_t ps;
+
+    memset(&ps, 0, sizeof(parser_state_t));
+    ps.scan = create_scanner();
+    ps.ast = create_ast();
+    // the files belong to the tree, so their locations are good until it is destroyed
+    ps.scan->source_owner = ps.ast;
+    ps.cache_dir = GET_CONFIG_STR("AST_CACHE");
+    scanner_t* prev = set_error_scanner(ps.scan);
+
+    ast_node_t* node = create_node(ps.ast, ROOT_NODE);
+    set_node_str(node, NAME_ATTR, intern_string("__root__"));
+    ps.ast->root = node;
 
-    ast_node_t* node = create_node(ROOT_NODE);
-    ADD_STR_ATTRIB(node, NAME_ATTR, "__root__");
+    parse_module(&ps, name, NULL, node);
 
-    parse_module(name, node);
+    set_error_scanner(prev);
+    destroy_scanner(ps.scan);
 
     if(get_num_errors() == 0)
-        return node; // root node
+        return ps.ast;
     else {
-        destroy_ast(node);
+        destroy_ast(ps.ast);
         return NULL; // no further processing if there are errors
     }
 }
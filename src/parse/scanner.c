@@ -1,2647 +0,0 @@
-#line 2 "scanner.c"
-
-#line 4 "scanner.c"
-
-#define  YY_INT_ALIGNED short int
-
-/* A lexical scanner generated by flex */
-
-#define FLEX_SCANNER
-#define YY_FLEX_MAJOR_VERSION 2
-#define YY_FLEX_MINOR_VERSION 6
-#define YY_FLEX_SUBMINOR_VERSION 4
-#if YY_FLEX_SUBMINOR_VERSION > 0
-#define FLEX_BETA
-#endif
-
-/* First, we deal with  platform-specific or compiler-specific issues. */
-
-/* begin standard C headers. */
-#include <stdio.h>
-#include <string.h>
-#include <errno.h>
-#include <stdlib.h>
-
-/* end standard C headers. */
-
-/* flex integer type definitions */
-
-#ifndef FLEXINT_H
-#define FLEXINT_H
-
-/* C99 systems have <inttypes.h>. Non-C99 systems may or may not. */
-
-#if defined (__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
-
-/* C99 says to define __STDC_LIMIT_MACROS before including stdint.h,
- * if you want the limit (max/min) macros for int types. 
- */
-#ifndef __STDC_LIMIT_MACROS
-#define __STDC_LIMIT_MACROS 1
-#endif
-
-#include <inttypes.h>
-typedef int8_t flex_int8_t;
-typedef uint8_t flex_uint8_t;
-typedef int16_t flex_int16_t;
-typedef uint16_t flex_uint16_t;
-typedef int32_t flex_int32_t;
-typedef uint32_t flex_uint32_t;
-#else
-typedef signed char flex_int8_t;
-typedef short int flex_int16_t;
-typedef int flex_int32_t;
-typedef unsigned char flex_uint8_t; 
-typedef unsigned short int flex_uint16_t;
-typedef unsigned int flex_uint32_t;
-
-/* Limits of integral types. */
-#ifndef INT8_MIN
-#define INT8_MIN               (-128)
-#endif
-#ifndef INT16_MIN
-#define INT16_MIN              (-32767-1)
-#endif
-#ifndef INT32_MIN
-#define INT32_MIN              (-2147483647-1)
-#endif
-#ifndef INT8_MAX
-#define INT8_MAX               (127)
-#endif
-#ifndef INT16_MAX
-#define INT16_MAX              (32767)
-#endif
-#ifndef INT32_MAX
-#define INT32_MAX              (2147483647)
-#endif
-#ifndef UINT8_MAX
-#define UINT8_MAX              (255U)
-#endif
-#ifndef UINT16_MAX
-#define UINT16_MAX             (65535U)
-#endif
-#ifndef UINT32_MAX
-#define UINT32_MAX             (4294967295U)
-#endif
-
-#ifndef SIZE_MAX
-#define SIZE_MAX               (~(size_t)0)
-#endif
-
-#endif /* ! C99 */
-
-#endif /* ! FLEXINT_H */
-
-/* begin standard C++ headers. */
-
-/* TODO: this is always defined, so inline it */
-#define yyconst const
-
-#if defined(__GNUC__) && __GNUC__ >= 3
-#define yynoreturn __attribute__((__noreturn__))
-#else
-#define yynoreturn
-#endif
-
-/* Returned upon end-of-file. */
-#define YY_NULL 0
-
-/* Promotes a possibly negative, possibly signed char to an
- *   integer in range [0..255] for use as an array index.
- */
-#define YY_SC_TO_UI(c) ((YY_CHAR) (c))
-
-/* Enter a start condition.  This macro really ought to take a parameter,
- * but we do it the disgusting crufty way forced on us by the ()-less
- * definition of BEGIN.
- */
-#define BEGIN (yy_start) = 1 + 2 *
-/* Translate the current start state into a value that can be later handed
- * to BEGIN to return to the state.  The YYSTATE alias is for lex
- * compatibility.
- */
-#define YY_START (((yy_start) - 1) / 2)
-#define YYSTATE YY_START
-/* Action number for EOF rule of a given start state. */
-#define YY_STATE_EOF(state) (YY_END_OF_BUFFER + state + 1)
-/* Special action meaning "start processing a new file". */
-#define YY_NEW_FILE yyrestart( yyin  )
-#define YY_END_OF_BUFFER_CHAR 0
-
-/* Size of default input buffer. */
-#ifndef YY_BUF_SIZE
-#ifdef __ia64__
-/* On IA-64, the buffer size is 16k, not 8k.
- * Moreover, YY_BUF_SIZE is 2*YY_READ_BUF_SIZE in the general case.
- * Ditto for the __ia64__ case accordingly.
- */
-#define YY_BUF_SIZE 32768
-#else
-#define YY_BUF_SIZE 16384
-#endif /* __ia64__ */
-#endif
-
-/* The state buf must be large enough to hold one state per character in the main buffer.
- */
-#define YY_STATE_BUF_SIZE   ((YY_BUF_SIZE + 2) * sizeof(yy_state_type))
-
-#ifndef YY_TYPEDEF_YY_BUFFER_STATE
-#define YY_TYPEDEF_YY_BUFFER_STATE
-typedef struct yy_buffer_state *YY_BUFFER_STATE;
-#endif
-
-#ifndef YY_TYPEDEF_YY_SIZE_T
-#define YY_TYPEDEF_YY_SIZE_T
-typedef size_t yy_size_t;
-#endif
-
-extern int yyleng;
-
-extern FILE *yyin, *yyout;
-
-#define EOB_ACT_CONTINUE_SCAN 0
-#define EOB_ACT_END_OF_FILE 1
-#define EOB_ACT_LAST_MATCH 2
-    
-    /* Note: We specifically omit the test for yy_rule_can_match_eol because it requires
-     *       access to the local variable yy_act. Since yyless() is a macro, it would break
-     *       existing scanners that call yyless() from OUTSIDE yylex.
-     *       One obvious solution it to make yy_act a global. I tried that, and saw
-     *       a 5% performance hit in a non-yylineno scanner, because yy_act is
-     *       normally declared as a register variable-- so it is not worth it.
-     */
-    #define  YY_LESS_LINENO(n) \
-            do { \
-                int yyl;\
-                for ( yyl = n; yyl < yyleng; ++yyl )\
-                    if ( yytext[yyl] == '\n' )\
-                        --yylineno;\
-            }while(0)
-    #define YY_LINENO_REWIND_TO(dst) \
-            do {\
-                const char *p;\
-                for ( p = yy_cp-1; p >= (dst); --p)\
-                    if ( *p == '\n' )\
-                        --yylineno;\
-            }while(0)
-    
-/* Return all but the first "n" matched characters back to the input stream. */
-#define yyless(n) \
-	do \
-		{ \
-		/* Undo effects of setting up yytext. */ \
-        int yyless_macro_arg = (n); \
-        YY_LESS_LINENO(yyless_macro_arg);\
-		*yy_cp = (yy_hold_char); \
-		YY_RESTORE_YY_MORE_OFFSET \
-		(yy_c_buf_p) = yy_cp = yy_bp + yyless_macro_arg - YY_MORE_ADJ; \
-		YY_DO_BEFORE_ACTION; /* set up yytext again */ \
-		} \
-	while ( 0 )
-#define unput(c) yyunput( c, (yytext_ptr)  )
-
-#ifndef YY_STRUCT_YY_BUFFER_STATE
-#define YY_STRUCT_YY_BUFFER_STATE
-struct yy_buffer_state
-	{
-	FILE *yy_input_file;
-
-	char *yy_ch_buf;		/* input buffer */
-	char *yy_buf_pos;		/* current position in input buffer */
-
-	/* Size of input buffer in bytes, not including room for EOB
-	 * characters.
-	 */
-	int yy_buf_size;
-
-	/* Number of characters read into yy_ch_buf, not including EOB
-	 * characters.
-	 */
-	int yy_n_chars;
-
-	/* Whether we "own" the buffer - i.e., we know we created it,
-	 * and can realloc() it to grow it, and should free() it to
-	 * delete it.
-	 */
-	int yy_is_our_buffer;
-
-	/* Whether this is an "interactive" input source; if so, and
-	 * if we're using stdio for input, then we want to use getc()
-	 * instead of fread(), to make sure we stop fetching input after
-	 * each newline.
-	 */
-	int yy_is_interactive;
-
-	/* Whether we're considered to be at the beginning of a line.
-	 * If so, '^' rules will be active on the next match, otherwise
-	 * not.
-	 */
-	int yy_at_bol;
-
-    int yy_bs_lineno; /**< The line count. */
-    int yy_bs_column; /**< The column count. */
-
-	/* Whether to try to fill the input buffer when we reach the
-	 * end of it.
-	 */
-	int yy_fill_buffer;
-
-	int yy_buffer_status;
-
-#define YY_BUFFER_NEW 0
-#define YY_BUFFER_NORMAL 1
-	/* When an EOF's been seen but there's still some text to process
-	 * then we mark the buffer as YY_EOF_PENDING, to indicate that we
-	 * shouldn't try reading from the input source any more.  We might
-	 * still have a bunch of tokens to match, though, because of
-	 * possible backing-up.
-	 *
-	 * When we actually see the EOF, we change the status to "new"
-	 * (via yyrestart()), so that the user can continue scanning by
-	 * just pointing yyin at a new input file.
-	 */
-#define YY_BUFFER_EOF_PENDING 2
-
-	};
-#endif /* !YY_STRUCT_YY_BUFFER_STATE */
-
-/* Stack of input buffers. */
-static size_t yy_buffer_stack_top = 0; /**< index of top of stack. */
-static size_t yy_buffer_stack_max = 0; /**< capacity of stack. */
-static YY_BUFFER_STATE * yy_buffer_stack = NULL; /**< Stack as an array. */
-
-/* We provide macros for accessing buffer states in case in the
- * future we want to put the buffer states in a more general
- * "scanner state".
- *
- * Returns the top of the stack, or NULL.
- */
-#define YY_CURRENT_BUFFER ( (yy_buffer_stack) \
-                          ? (yy_buffer_stack)[(yy_buffer_stack_top)] \
-                          : NULL)
-/* Same as previous macro, but useful when we know that the buffer stack is not
- * NULL or when we need an lvalue. For internal use only.
- */
-#define YY_CURRENT_BUFFER_LVALUE (yy_buffer_stack)[(yy_buffer_stack_top)]
-
-/* yy_hold_char holds the character lost when yytext is formed. */
-static char yy_hold_char;
-static int yy_n_chars;		/* number of characters read into yy_ch_buf */
-int yyleng;
-
-/* Points to current character in buffer. */
-static char *yy_c_buf_p = NULL;
-static int yy_init = 0;		/* whether we need to initialize */
-static int yy_start = 0;	/* start state number */
-
-/* Flag which is used to allow yywrap()'s to do buffer switches
- * instead of setting up a fresh yyin.  A bit of a hack ...
- */
-static int yy_did_buffer_switch_on_eof;
-
-void yyrestart ( FILE *input_file  );
-void yy_switch_to_buffer ( YY_BUFFER_STATE new_buffer  );
-YY_BUFFER_STATE yy_create_buffer ( FILE *file, int size  );
-void yy_delete_buffer ( YY_BUFFER_STATE b  );
-void yy_flush_buffer ( YY_BUFFER_STATE b  );
-void yypush_buffer_state ( YY_BUFFER_STATE new_buffer  );
-void yypop_buffer_state ( void );
-
-static void yyensure_buffer_stack ( void );
-static void yy_load_buffer_state ( void );
-static void yy_init_buffer ( YY_BUFFER_STATE b, FILE *file  );
-#define YY_FLUSH_BUFFER yy_flush_buffer( YY_CURRENT_BUFFER )
-
-YY_BUFFER_STATE yy_scan_buffer ( char *base, yy_size_t size  );
-YY_BUFFER_STATE yy_scan_string ( const char *yy_str  );
-YY_BUFFER_STATE yy_scan_bytes ( const char *bytes, int len  );
-
-void *yyalloc ( yy_size_t  );
-void *yyrealloc ( void *, yy_size_t  );
-void yyfree ( void *  );
-
-#define yy_new_buffer yy_create_buffer
-#define yy_set_interactive(is_interactive) \
-	{ \
-	if ( ! YY_CURRENT_BUFFER ){ \
-        yyensure_buffer_stack (); \
-		YY_CURRENT_BUFFER_LVALUE =    \
-            yy_create_buffer( yyin, YY_BUF_SIZE ); \
-	} \
-	YY_CURRENT_BUFFER_LVALUE->yy_is_interactive = is_interactive; \
-	}
-#define yy_set_bol(at_bol) \
-	{ \
-	if ( ! YY_CURRENT_BUFFER ){\
-        yyensure_buffer_stack (); \
-		YY_CURRENT_BUFFER_LVALUE =    \
-            yy_create_buffer( yyin, YY_BUF_SIZE ); \
-	} \
-	YY_CURRENT_BUFFER_LVALUE->yy_at_bol = at_bol; \
-	}
-#define YY_AT_BOL() (YY_CURRENT_BUFFER_LVALUE->yy_at_bol)
-
-/* Begin user sect3 */
-
-#define yywrap() (/*CONSTCOND*/1)
-#define YY_SKIP_YYWRAP
-typedef flex_uint8_t YY_CHAR;
-
-FILE *yyin = NULL, *yyout = NULL;
-
-typedef int yy_state_type;
-
-extern int yylineno;
-int yylineno = 1;
-
-extern char *yytext;
-#ifdef yytext_ptr
-#undef yytext_ptr
-#endif
-#define yytext_ptr yytext
-
-static yy_state_type yy_get_previous_state ( void );
-static yy_state_type yy_try_NUL_trans ( yy_state_type current_state  );
-static int yy_get_next_buffer ( void );
-static void yynoreturn yy_fatal_error ( const char* msg  );
-
-/* Done after the current pattern has been matched and before the
- * corresponding action - sets up yytext.
- */
-#define YY_DO_BEFORE_ACTION \
-	(yytext_ptr) = yy_bp; \
-	yyleng = (int) (yy_cp - yy_bp); \
-	(yy_hold_char) = *yy_cp; \
-	*yy_cp = '\0'; \
-	(yy_c_buf_p) = yy_cp;
-#define YY_NUM_RULES 96
-#define YY_END_OF_BUFFER 97
-/* This struct is not used in this scanner,
-   but its presence is necessary. */
-struct yy_trans_info
-	{
-	flex_int32_t yy_verify;
-	flex_int32_t yy_nxt;
-	};
-static const flex_int16_t yy_accept[236] =
-    {   0,
-        0,    0,   93,   93,   90,   90,    0,    0,   97,   95,
-        2,    1,   48,   75,   54,   47,   91,   66,   67,   52,
-       51,   63,   50,   70,   53,   72,   72,   64,   60,   55,
-       65,   56,   59,   71,   68,   69,   57,   71,   71,   71,
-       71,   71,   71,   71,   71,   71,   71,   71,   71,   71,
-       71,   71,   71,   71,   71,   71,   61,   58,   62,   49,
-       93,   96,   92,   96,   90,   76,   96,    6,    5,    6,
-       44,   39,    0,    0,    3,    7,    0,   72,    0,   46,
-       41,   43,   42,   45,   71,   71,   71,   71,   71,   71,
-       71,   20,   71,   43,   71,   71,   71,   71,   42,   23,
-
-       71,   71,   41,   71,   44,   40,   71,   71,   71,   71,
-       71,   71,   71,   71,   71,   71,   71,   40,   93,   94,
-       90,   87,   84,   85,   87,   86,   87,   83,   80,   81,
-       77,   78,   79,   82,    4,   38,    7,   74,   73,   39,
-       71,   71,   71,   71,   71,   71,   71,   71,   71,   22,
-       71,   27,   71,   71,   71,   71,   71,   71,   71,   71,
-       71,   71,   71,   71,   71,   88,   89,    0,   74,    0,
-       29,   71,   18,   71,   71,   71,   24,   71,   71,   71,
-       71,   25,   71,   71,   71,   71,   71,   71,   34,   71,
-       71,   28,   30,   71,   71,   88,   89,   74,   13,   10,
-
-       71,   71,   71,   35,   26,   71,   71,   71,   71,   71,
-       71,   71,   32,   71,   71,   21,   16,   89,   71,   71,
-        9,    8,   15,   36,   11,   31,   33,   17,   71,   37,
-       71,   19,   12,   14,    0
-    } ;
-
-static const YY_CHAR yy_ec[256] =
-    {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    2,    3,
-        2,    2,    2,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    2,    4,    5,    1,    1,    6,    7,    8,    9,
-       10,   11,   12,   13,   14,   15,   16,   17,   18,   18,
-       18,   18,   18,   18,   18,   19,   19,   20,   21,   22,
-       23,   24,   25,    1,   26,   26,   26,   26,   27,   26,
-       28,   28,   28,   28,   28,   28,   28,   28,   28,   28,
-       28,   28,   28,   28,   28,   28,   28,   29,   28,   28,
-       30,   31,   32,   33,   28,    1,   34,   35,   36,   37,
-
-       38,   39,   40,   41,   42,   28,   43,   44,   45,   46,
-       47,   48,   49,   50,   51,   52,   53,   54,   55,   56,
-       57,   58,   59,   60,   61,   62,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1
-    } ;
-
-static const YY_CHAR yy_meta[63] =
-    {   0,
-        1,    1,    2,    1,    3,    1,    1,    4,    1,    1,
-        1,    1,    1,    1,    5,    1,    6,    6,    6,    1,
-        1,    1,    1,    1,    1,    6,    6,    5,    5,    1,
-        7,    1,    1,    6,    6,    6,    6,    6,    6,    5,
-        5,    5,    5,    5,    5,    5,    5,    5,    5,    5,
-        5,    5,    5,    5,    5,    5,    5,    5,    1,    1,
-        1,    1
-    } ;
-
-static const flex_int16_t yy_base[249] =
-    {   0,
-        0,    0,   60,   61,   62,   67,   63,   68,  335,  336,
-      336,  336,  311,  336,  336,  326,  336,  336,  336,  336,
-       58,  336,   63,  317,   62,   68,   84,  336,  336,   66,
-      308,   71,  336,    0,  336,  336,  336,  284,   57,   62,
-       67,   62,   66,  291,   76,  290,  293,  288,  275,  286,
-       74,   70,  281,  275,  280,  278,  336,  259,  336,  336,
-        0,  336,  336,    0,    0,  336,  125,  336,  336,  302,
-      336,  336,  117,  302,  336,    0,  120,  129,    0,  336,
-      336,  336,  336,  336,    0,  279,  268,  276,  262,  266,
-      272,    0,  259,    0,  257,  264,  260,  256,    0,    0,
-
-      257,  252,    0,  261,    0,    0,  250,  243,   78,  258,
-      246,  250,  249,  250,  253,  252,  255,  336,    0,  336,
-        0,  336,  336,  336,  123,  336,    0,  336,  336,  336,
-      336,  336,  336,  336,  336,  336,    0,  149,    0,    0,
-      248,  257,  252,  100,  255,  250,  249,  235,  251,    0,
-      237,    0,  237,  229,  243,  228,   66,  227,  240,  233,
-      238,  223,  237,  229,  223,  140,    0,  155,  166,  178,
-        0,  217,    0,  203,  212,  194,    0,  193,  203,  163,
-      164,    0,  163,  165,  169,  164,  173,  172,    0,  169,
-      108,    0,    0,  168,  166,  336,    0,  181,    0,    0,
-
-      156,  157,  148,    0,    0,  139,  143,  149,  150,  142,
-      118,  128,    0,  127,  123,    0,    0,  336,  106,  101,
-        0,    0,    0,    0,    0,    0,    0,    0,  110,    0,
-       93,    0,    0,    0,  336,  216,  223,  230,  233,  239,
-      245,  252,  258,  265,  119,  111,   84,   78
-    } ;
-
-static const flex_int16_t yy_def[249] =
-    {   0,
-      235,    1,  236,  236,  237,  237,  238,  238,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  239,  235,  235,  235,  239,  239,  239,
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  239,  235,  235,  235,  235,
-      240,  235,  235,  241,  242,  235,  243,  235,  235,  235,
-      235,  235,  235,  235,  235,  244,  235,  235,  245,  235,
-      235,  235,  235,  235,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  239,  239,  235,  240,  235,
-      242,  235,  235,  235,  235,  235,  246,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  244,  235,  245,  239,
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  235,  247,  235,  235,  235,
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  235,  248,  235,  239,  239,
-
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,  239,  239,  239,  235,  239,  239,
-      239,  239,  239,  239,  239,  239,  239,  239,  239,  239,
-      239,  239,  239,  239,    0,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235
-    } ;
-
-static const flex_int16_t yy_nxt[399] =
-    {   0,
-       10,   11,   12,   13,   14,   15,   16,   17,   18,   19,
-       20,   21,   22,   23,   24,   25,   26,   27,   27,   28,
-       29,   30,   31,   32,   33,   34,   34,   34,   34,   35,
-       10,   36,   37,   38,   39,   40,   41,   42,   43,   44,
-       34,   45,   34,   46,   47,   48,   49,   34,   34,   50,
-       51,   52,   53,   54,   55,   34,   56,   34,   57,   58,
-       59,   60,   62,   62,   62,   69,   66,   63,   63,   62,
-       69,   66,   75,   70,   73,   73,   73,   76,   70,   73,
-       73,   73,   77,  218,   78,   78,   78,   80,   81,  197,
-       64,   64,   67,   83,   84,   89,   79,   67,   77,   96,
-
-       78,   78,   78,   87,   91,   93,   88,  186,   90,   97,
-       94,  156,   98,   92,  100,  108,  167,   95,  187,  111,
-      101,  102,  112,   79,  139,  109,  113,  157,  110,  123,
-      234,   77,  124,   73,   73,   73,  138,  138,  138,  166,
-      166,  125,  125,   77,  214,   78,   78,   78,  233,  126,
-      174,  175,  232,  127,  215,  128,  196,  196,  231,  129,
-      168,  230,  168,  130,  229,  169,  169,  169,  228,  227,
-      131,  198,  198,  198,  132,  170,  133,  168,  134,  168,
-      127,  226,  169,  169,  169,  225,  170,  224,  223,  168,
-      222,  168,  170,  221,  198,  198,  198,  198,  198,  198,
-
-      220,  219,  217,  170,  170,  216,  213,  212,  211,  210,
-      209,  208,  207,  206,  205,  170,   61,   61,   61,   61,
-       61,   61,   61,   65,   65,   65,   65,   65,   65,   65,
-       68,   68,   68,   68,   68,   68,   68,   85,   85,  119,
-      204,  119,  203,  119,  119,  120,  202,  120,  120,  120,
-      120,  120,  121,  201,  200,  121,  121,  121,  122,  199,
-      122,  122,  122,  122,  122,  137,  195,  137,  137,  137,
-      137,  137,  194,  193,  192,  191,  190,  189,  188,  185,
-      184,  183,  182,  181,  180,  179,  178,  177,  176,  173,
-      172,  171,  165,  164,  163,  162,  161,  160,  159,  158,
-
-      155,  154,  153,  152,  151,  150,  149,  148,  147,  146,
-      145,  144,  143,  142,  141,  140,  136,  135,  118,  117,
-      116,  115,  114,  107,  106,  105,  104,  103,   99,   86,
-       82,   74,   72,   71,  235,    9,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235
-
-    } ;
-
-static const flex_int16_t yy_chk[399] =
-    {   0,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    1,    1,    1,    1,    1,    1,    1,    1,
-        1,    1,    3,    4,    5,    7,    5,    3,    4,    6,
-        8,    6,   25,    7,   21,   21,   21,   25,    8,   23,
-       23,   23,   26,  248,   26,   26,   26,   30,   30,  247,
-        3,    4,    5,   32,   32,   40,   26,    6,   27,   43,
-
-       27,   27,   27,   39,   41,   42,   39,  157,   40,   43,
-       42,  109,   43,   41,   45,   51,  246,   42,  157,   52,
-       45,   45,   52,   26,  245,   51,   52,  109,   51,   67,
-      231,   73,   67,   73,   73,   73,   77,   77,   77,  125,
-      125,   67,   67,   78,  191,   78,   78,   78,  229,   67,
-      144,  144,  220,   67,  191,   67,  166,  166,  219,   67,
-      138,  215,  138,   67,  214,  138,  138,  138,  212,  211,
-       67,  168,  168,  168,   67,  138,   67,  169,   67,  169,
-       67,  210,  169,  169,  169,  209,  138,  208,  207,  170,
-      206,  170,  169,  203,  170,  170,  170,  198,  198,  198,
-
-      202,  201,  195,  169,  170,  194,  190,  188,  187,  186,
-      185,  184,  183,  181,  180,  170,  236,  236,  236,  236,
-      236,  236,  236,  237,  237,  237,  237,  237,  237,  237,
-      238,  238,  238,  238,  238,  238,  238,  239,  239,  240,
-      179,  240,  178,  240,  240,  241,  176,  241,  241,  241,
-      241,  241,  242,  175,  174,  242,  242,  242,  243,  172,
-      243,  243,  243,  243,  243,  244,  165,  244,  244,  244,
-      244,  244,  164,  163,  162,  161,  160,  159,  158,  156,
-      155,  154,  153,  151,  149,  148,  147,  146,  145,  143,
-      142,  141,  117,  116,  115,  114,  113,  112,  111,  110,
-
-      108,  107,  104,  102,  101,   98,   97,   96,   95,   93,
-       91,   90,   89,   88,   87,   86,   74,   70,   58,   56,
-       55,   54,   53,   50,   49,   48,   47,   46,   44,   38,
-       31,   24,   16,   13,    9,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235,  235,  235,
-      235,  235,  235,  235,  235,  235,  235,  235
-
-    } ;
-
-/* Table of booleans, true if rule could match eol. */
-static const flex_int32_t yy_rule_can_match_eol[97] =
-    {   0,
-1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 
-    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,     };
-
-static yy_state_type yy_last_accepting_state;
-static char *yy_last_accepting_cpos;
-
-extern int yy_flex_debug;
-int yy_flex_debug = 0;
-
-/* The intent behind this definition is that it'll catch
- * any uses of REJECT which flex missed.
- */
-#define REJECT reject_used_but_not_detected
-#define yymore() yymore_used_but_not_detected
-#define YY_MORE_ADJ 0
-#define YY_RESTORE_YY_MORE_OFFSET
-char *yytext;
-#line 1 "scanner.l"
-/*
- *
- * ANSI C grammar, Lex specification
- * In 1985, Jeff Lee published this Lex specification together with a Yacc grammar for the April 30, 1985 ANSI C draft.
- * Tom Stockfisch reposted both to net.sources in 1987; that original, as mentioned in the answer to question 17.25 of
- * the comp.lang.c FAQ, can be ftp'ed from ftp.uu.net, file usenet/net.sources/ansi.c.grammar.Z.
- *
- * I intend to keep this version as close to the current C Standard grammar as possible; please let me know if you
- * discover discrepancies.
- *
- * Jutta Degener, 1995
- * https://www.lysator.liu.se/c/ANSI-C-grammar-l.html
- */
-#line 23 "scanner.l"
-
-#include "common.h"
-#include "internal.h"
-
-// string buffer to get token from
-//static char strbuf[1024*64];
-
-#define SET_TOKEN_STATE(t) do{ \
-            scanner_state.token = t; \
-            strncpy(scanner_state.value.str, yytext, sizeof(scanner_state.value.str)); \
-            return t; \
-        }while(0)
-
-#define SET_STRG_STATE() do{ \
-            scanner_state.token = STRING_LITERAL; \
-            strncpy(scanner_state.value.str, buffer, sizeof(scanner_state.value.str)); \
-            BEGIN(INITIAL); \
-            return STRING_LITERAL; \
-        }while(0)
-
-#define SET_IDENT_STATE() SET_TOKEN_STATE(check_type())
-
-#define SET_UNUM_STATE() do{ \
-            scanner_state.token = UNUM_LITERAL; \
-            scanner_state.value.unum = strtol(yytext, NULL, 16); \
-            return UNUM_LITERAL; \
-        } while(0)
-
-#define SET_INUM_STATE() do{ \
-            scanner_state.token = INUM_LITERAL; \
-            scanner_state.value.inum = strtol(yytext, NULL, 10); \
-            return INUM_LITERAL; \
-        } while(0)
-
-#define SET_FNUM_STATE() do{ \
-            scanner_state.token = FNUM_LITERAL; \
-            scanner_state.value.fnum = strtod(yytext, NULL); \
-            return FNUM_LITERAL; \
-        } while(0)
-
-typedef struct _file_name_stack {
-    //int line_no;
-    //int col_no;
-    YY_BUFFER_STATE state;
-    char *name;
-    struct _file_name_stack *next;
-} _file_name_stack;
-
-int check_type(void);
-void close_file(void);
-void append_char(char ch);
-void append_str(char *str);
-void update_loc(void);
-
-scanner_state_t scanner_state;
-
-char buffer[1024*64];
-int bidx = 0;
-_file_name_stack *name_stack;
-int num_errors = 0; // global updated by parser
-
-#line 717 "scanner.c"
-
-#define YY_NO_INPUT 1
-#line 720 "scanner.c"
-
-#define INITIAL 0
-#define SQUOTES 1
-#define DQUOTES 2
-#define COMMENT 3
-
-#ifndef YY_NO_UNISTD_H
-/* Special case for "unistd.h", since it is non-ANSI. We include it way
- * down here because we want the user's section 1 to have been scanned first.
- * The user has a chance to override it with an option.
- */
-#include <unistd.h>
-#endif
-
-#ifndef YY_EXTRA_TYPE
-#define YY_EXTRA_TYPE void *
-#endif
-
-static int yy_init_globals ( void );
-
-/* Accessor methods to globals.
-   These are made visible to non-reentrant scanners for convenience. */
-
-int yylex_destroy ( void );
-
-int yyget_debug ( void );
-
-void yyset_debug ( int debug_flag  );
-
-YY_EXTRA_TYPE yyget_extra ( void );
-
-void yyset_extra ( YY_EXTRA_TYPE user_defined  );
-
-FILE *yyget_in ( void );
-
-void yyset_in  ( FILE * _in_str  );
-
-FILE *yyget_out ( void );
-
-void yyset_out  ( FILE * _out_str  );
-
-			int yyget_leng ( void );
-
-char *yyget_text ( void );
-
-int yyget_lineno ( void );
-
-void yyset_lineno ( int _line_number  );
-
-/* Macros after this point can all be overridden by user definitions in
- * section 1.
- */
-
-#ifndef YY_SKIP_YYWRAP
-#ifdef __cplusplus
-extern "C" int yywrap ( void );
-#else
-extern int yywrap ( void );
-#endif
-#endif
-
-#ifndef YY_NO_UNPUT
-    
-#endif
-
-#ifndef yytext_ptr
-static void yy_flex_strncpy ( char *, const char *, int );
-#endif
-
-#ifdef YY_NEED_STRLEN
-static int yy_flex_strlen ( const char * );
-#endif
-
-#ifndef YY_NO_INPUT
-#ifdef __cplusplus
-static int yyinput ( void );
-#else
-static int input ( void );
-#endif
-
-#endif
-
-/* Amount of stuff to slurp up with each read. */
-#ifndef YY_READ_BUF_SIZE
-#ifdef __ia64__
-/* On IA-64, the buffer size is 16k, not 8k */
-#define YY_READ_BUF_SIZE 16384
-#else
-#define YY_READ_BUF_SIZE 8192
-#endif /* __ia64__ */
-#endif
-
-/* Copy whatever the last rule matched to the standard output. */
-#ifndef ECHO
-/* This used to be an fputs(), but since the string might contain NUL's,
- * we now use fwrite().
- */
-#define ECHO do { if (fwrite( yytext, (size_t) yyleng, 1, yyout )) {} } while (0)
-#endif
-
-/* Gets input and stuffs it into "buf".  number of characters read, or YY_NULL,
- * is returned in "result".
- */
-#ifndef YY_INPUT
-#define YY_INPUT(buf,result,max_size) \
-	if ( YY_CURRENT_BUFFER_LVALUE->yy_is_interactive ) \
-		{ \
-		int c = '*'; \
-		int n; \
-		for ( n = 0; n < max_size && \
-			     (c = getc( yyin )) != EOF && c != '\n'; ++n ) \
-			buf[n] = (char) c; \
-		if ( c == '\n' ) \
-			buf[n++] = (char) c; \
-		if ( c == EOF && ferror( yyin ) ) \
-			YY_FATAL_ERROR( "input in flex scanner failed" ); \
-		result = n; \
-		} \
-	else \
-		{ \
-		errno=0; \
-		while ( (result = (int) fread(buf, 1, (yy_size_t) max_size, yyin)) == 0 && ferror(yyin)) \
-			{ \
-			if( errno != EINTR) \
-				{ \
-				YY_FATAL_ERROR( "input in flex scanner failed" ); \
-				break; \
-				} \
-			errno=0; \
-			clearerr(yyin); \
-			} \
-		}\
-\
-
-#endif
-
-/* No semi-colon after return; correct usage is to write "yyterminate();" -
- * we don't want an extra ';' after the "return" because that will cause
- * some compilers to complain about unreachable statements.
- */
-#ifndef yyterminate
-#define yyterminate() return YY_NULL
-#endif
-
-/* Number of entries by which start-condition stack grows. */
-#ifndef YY_START_STACK_INCR
-#define YY_START_STACK_INCR 25
-#endif
-
-/* Report a fatal error. */
-#ifndef YY_FATAL_ERROR
-#define YY_FATAL_ERROR(msg) yy_fatal_error( msg )
-#endif
-
-/* end tables serialization structures and prototypes */
-
-/* Default declaration of generated scanner - a define so the user can
- * easily add parameters.
- */
-#ifndef YY_DECL
-#define YY_DECL_IS_OURS 1
-
-extern int yylex (void);
-
-#define YY_DECL int yylex (void)
-#endif /* !YY_DECL */
-
-/* Code executed at the beginning of each rule, after yytext and yyleng
- * have been set up.
- */
-#ifndef YY_USER_ACTION
-#define YY_USER_ACTION
-#endif
-
-/* Code executed at the end of each rule. */
-#ifndef YY_BREAK
-#define YY_BREAK /*LINTED*/break;
-#endif
-
-#define YY_RULE_SETUP \
-	YY_USER_ACTION
-
-/** The main scanner function which does all the work.
- */
-YY_DECL
-{
-	yy_state_type yy_current_state;
-	char *yy_cp, *yy_bp;
-	int yy_act;
-    
-	if ( !(yy_init) )
-		{
-		(yy_init) = 1;
-
-#ifdef YY_USER_INIT
-		YY_USER_INIT;
-#endif
-
-		if ( ! (yy_start) )
-			(yy_start) = 1;	/* first start state */
-
-		if ( ! yyin )
-			yyin = stdin;
-
-		if ( ! yyout )
-			yyout = stdout;
-
-		if ( ! YY_CURRENT_BUFFER ) {
-			yyensure_buffer_stack ();
-			YY_CURRENT_BUFFER_LVALUE =
-				yy_create_buffer( yyin, YY_BUF_SIZE );
-		}
-
-		yy_load_buffer_state(  );
-		}
-
-	{
-#line 92 "scanner.l"
-
-#line 94 "scanner.l"
-    /* whitespace */
-#line 942 "scanner.c"
-
-	while ( /*CONSTCOND*/1 )		/* loops until end-of-file is reached */
-		{
-		yy_cp = (yy_c_buf_p);
-
-		/* Support of yytext. */
-		*yy_cp = (yy_hold_char);
-
-		/* yy_bp points to the position in yy_ch_buf of the start of
-		 * the current run.
-		 */
-		yy_bp = yy_cp;
-
-		yy_current_state = (yy_start);
-yy_match:
-		do
-			{
-			YY_CHAR yy_c = yy_ec[YY_SC_TO_UI(*yy_cp)] ;
-			if ( yy_accept[yy_current_state] )
-				{
-				(yy_last_accepting_state) = yy_current_state;
-				(yy_last_accepting_cpos) = yy_cp;
-				}
-			while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
-				{
-				yy_current_state = (int) yy_def[yy_current_state];
-				if ( yy_current_state >= 236 )
-					yy_c = yy_meta[yy_c];
-				}
-			yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
-			++yy_cp;
-			}
-		while ( yy_base[yy_current_state] != 336 );
-
-yy_find_action:
-		yy_act = yy_accept[yy_current_state];
-		if ( yy_act == 0 )
-			{ /* have to back up */
-			yy_cp = (yy_last_accepting_cpos);
-			yy_current_state = (yy_last_accepting_state);
-			yy_act = yy_accept[yy_current_state];
-			}
-
-		YY_DO_BEFORE_ACTION;
-
-		if ( yy_act != YY_END_OF_BUFFER && yy_rule_can_match_eol[yy_act] )
-			{
-			int yyl;
-			for ( yyl = 0; yyl < yyleng; ++yyl )
-				if ( yytext[yyl] == '\n' )
-					
-    yylineno++;
-;
-			}
-
-do_action:	/* This label is used only to access EOF actions. */
-
-		switch ( yy_act )
-	{ /* beginning of action switch */
-			case 0: /* must back up */
-			/* undo the effects of YY_DO_BEFORE_ACTION */
-			*yy_cp = (yy_hold_char);
-			yy_cp = (yy_last_accepting_cpos);
-			yy_current_state = (yy_last_accepting_state);
-			goto yy_find_action;
-
-case 1:
-/* rule 1 can match eol */
-YY_RULE_SETUP
-#line 95 "scanner.l"
-{ name_stack->state->yy_bs_lineno++; name_stack->state->yy_bs_column=0; }
-	YY_BREAK
-case 2:
-YY_RULE_SETUP
-#line 96 "scanner.l"
-{}
-	YY_BREAK
-/* recognize and ignore a C comments */
-case 3:
-YY_RULE_SETUP
-#line 99 "scanner.l"
-{ BEGIN(COMMENT); }
-	YY_BREAK
-case 4:
-YY_RULE_SETUP
-#line 100 "scanner.l"
-{ BEGIN(INITIAL); }
-	YY_BREAK
-case 5:
-/* rule 5 can match eol */
-YY_RULE_SETUP
-#line 101 "scanner.l"
-{ name_stack->state->yy_bs_lineno++; yylineno++; name_stack->state->yy_bs_column=0; }
-	YY_BREAK
-case 6:
-YY_RULE_SETUP
-#line 102 "scanner.l"
-{}  /* eat everything in between */
-	YY_BREAK
-case 7:
-YY_RULE_SETUP
-#line 103 "scanner.l"
-{} /* eat up until the newline */
-	YY_BREAK
-/* Keyword tokens */
-case 8:
-YY_RULE_SETUP
-#line 106 "scanner.l"
-{ SET_TOKEN_STATE(IMPORT); }
-	YY_BREAK
-case 9:
-YY_RULE_SETUP
-#line 107 "scanner.l"
-{ SET_TOKEN_STATE(EXTERN); }
-	YY_BREAK
-case 10:
-YY_RULE_SETUP
-#line 108 "scanner.l"
-{ SET_TOKEN_STATE(CONST); }
-	YY_BREAK
-case 11:
-YY_RULE_SETUP
-#line 109 "scanner.l"
-{ SET_TOKEN_STATE(STATIC); }
-	YY_BREAK
-case 12:
-YY_RULE_SETUP
-#line 110 "scanner.l"
-{ SET_TOKEN_STATE(TYPEDEF); }
-	YY_BREAK
-case 13:
-YY_RULE_SETUP
-#line 112 "scanner.l"
-{ SET_TOKEN_STATE(BREAK); }
-	YY_BREAK
-case 14:
-YY_RULE_SETUP
-#line 113 "scanner.l"
-{ SET_TOKEN_STATE(CONTINUE); }
-	YY_BREAK
-case 15:
-YY_RULE_SETUP
-#line 114 "scanner.l"
-{ SET_TOKEN_STATE(RETURN); }
-	YY_BREAK
-case 16:
-YY_RULE_SETUP
-#line 115 "scanner.l"
-{ SET_TOKEN_STATE(YIELD); }
-	YY_BREAK
-case 17:
-YY_RULE_SETUP
-#line 117 "scanner.l"
-{ SET_TOKEN_STATE(SWITCH); }
-	YY_BREAK
-case 18:
-YY_RULE_SETUP
-#line 118 "scanner.l"
-{ SET_TOKEN_STATE(CASE); }
-	YY_BREAK
-case 19:
-YY_RULE_SETUP
-#line 119 "scanner.l"
-{ SET_TOKEN_STATE(DEFAULT); }
-	YY_BREAK
-case 20:
-YY_RULE_SETUP
-#line 120 "scanner.l"
-{ SET_TOKEN_STATE(DO); }
-	YY_BREAK
-case 21:
-YY_RULE_SETUP
-#line 121 "scanner.l"
-{ SET_TOKEN_STATE(WHILE); }
-	YY_BREAK
-case 22:
-YY_RULE_SETUP
-#line 122 "scanner.l"
-{ SET_TOKEN_STATE(FOR); }
-	YY_BREAK
-case 23:
-YY_RULE_SETUP
-#line 123 "scanner.l"
-{ SET_TOKEN_STATE(IF); }
-	YY_BREAK
-case 24:
-YY_RULE_SETUP
-#line 124 "scanner.l"
-{ SET_TOKEN_STATE(ELSE); }
-	YY_BREAK
-case 25:
-YY_RULE_SETUP
-#line 125 "scanner.l"
-{ SET_TOKEN_STATE(MAIN); }
-	YY_BREAK
-case 26:
-YY_RULE_SETUP
-#line 127 "scanner.l"
-{ SET_TOKEN_STATE(FLOAT); }
-	YY_BREAK
-case 27:
-YY_RULE_SETUP
-#line 128 "scanner.l"
-{ SET_TOKEN_STATE(INT); }
-	YY_BREAK
-case 28:
-YY_RULE_SETUP
-#line 129 "scanner.l"
-{ SET_TOKEN_STATE(UINT); }
-	YY_BREAK
-case 29:
-YY_RULE_SETUP
-#line 130 "scanner.l"
-{ SET_TOKEN_STATE(BOOL); }
-	YY_BREAK
-case 30:
-YY_RULE_SETUP
-#line 131 "scanner.l"
-{ SET_TOKEN_STATE(VOID); }
-	YY_BREAK
-case 31:
-YY_RULE_SETUP
-#line 132 "scanner.l"
-{ SET_TOKEN_STATE(STRING); }
-	YY_BREAK
-case 32:
-YY_RULE_SETUP
-#line 133 "scanner.l"
-{ SET_TOKEN_STATE(TUPLE); }
-	YY_BREAK
-case 33:
-YY_RULE_SETUP
-#line 134 "scanner.l"
-{ SET_TOKEN_STATE(STRUCT); }
-	YY_BREAK
-case 34:
-YY_RULE_SETUP
-#line 136 "scanner.l"
-{ SET_TOKEN_STATE(TRUE); }
-	YY_BREAK
-case 35:
-YY_RULE_SETUP
-#line 137 "scanner.l"
-{ SET_TOKEN_STATE(FALSE); }
-	YY_BREAK
-case 36:
-YY_RULE_SETUP
-#line 138 "scanner.l"
-{ SET_TOKEN_STATE(SIZEOF); }
-	YY_BREAK
-case 37:
-YY_RULE_SETUP
-#line 139 "scanner.l"
-{ SET_TOKEN_STATE(TYPEOF); }
-	YY_BREAK
-case 38:
-YY_RULE_SETUP
-#line 141 "scanner.l"
-{ SET_TOKEN_STATE(ELLIPSIS); }
-	YY_BREAK
-/* Operator tokens */
-case 39:
-YY_RULE_SETUP
-#line 144 "scanner.l"
-{ SET_TOKEN_STATE(AND_OP); }
-	YY_BREAK
-case 40:
-YY_RULE_SETUP
-#line 145 "scanner.l"
-{ SET_TOKEN_STATE(OR_OP); }
-	YY_BREAK
-case 41:
-YY_RULE_SETUP
-#line 146 "scanner.l"
-{ SET_TOKEN_STATE(LE_OP); }
-	YY_BREAK
-case 42:
-YY_RULE_SETUP
-#line 147 "scanner.l"
-{ SET_TOKEN_STATE(GE_OP); }
-	YY_BREAK
-case 43:
-YY_RULE_SETUP
-#line 148 "scanner.l"
-{ SET_TOKEN_STATE(EQ_OP); }
-	YY_BREAK
-case 44:
-YY_RULE_SETUP
-#line 149 "scanner.l"
-{ SET_TOKEN_STATE(NE_OP); }
-	YY_BREAK
-case 45:
-YY_RULE_SETUP
-#line 150 "scanner.l"
-{ SET_TOKEN_STATE(RIGHT_OP); }
-	YY_BREAK
-case 46:
-YY_RULE_SETUP
-#line 151 "scanner.l"
-{ SET_TOKEN_STATE(LEFT_OP); }
-	YY_BREAK
-case 47:
-YY_RULE_SETUP
-#line 153 "scanner.l"
-{ SET_TOKEN_STATE('&'); }
-	YY_BREAK
-case 48:
-YY_RULE_SETUP
-#line 154 "scanner.l"
-{ SET_TOKEN_STATE('!'); }
-	YY_BREAK
-case 49:
-YY_RULE_SETUP
-#line 155 "scanner.l"
-{ SET_TOKEN_STATE('~'); }
-	YY_BREAK
-case 50:
-YY_RULE_SETUP
-#line 156 "scanner.l"
-{ SET_TOKEN_STATE('-'); }
-	YY_BREAK
-case 51:
-YY_RULE_SETUP
-#line 157 "scanner.l"
-{ SET_TOKEN_STATE('+'); }
-	YY_BREAK
-case 52:
-YY_RULE_SETUP
-#line 158 "scanner.l"
-{ SET_TOKEN_STATE('*'); }
-	YY_BREAK
-case 53:
-YY_RULE_SETUP
-#line 159 "scanner.l"
-{ SET_TOKEN_STATE('/'); }
-	YY_BREAK
-case 54:
-YY_RULE_SETUP
-#line 160 "scanner.l"
-{ SET_TOKEN_STATE('%'); }
-	YY_BREAK
-case 55:
-YY_RULE_SETUP
-#line 161 "scanner.l"
-{ SET_TOKEN_STATE('<'); }
-	YY_BREAK
-case 56:
-YY_RULE_SETUP
-#line 162 "scanner.l"
-{ SET_TOKEN_STATE('>'); }
-	YY_BREAK
-case 57:
-YY_RULE_SETUP
-#line 163 "scanner.l"
-{ SET_TOKEN_STATE('^'); }
-	YY_BREAK
-case 58:
-YY_RULE_SETUP
-#line 164 "scanner.l"
-{ SET_TOKEN_STATE('|'); }
-	YY_BREAK
-case 59:
-YY_RULE_SETUP
-#line 165 "scanner.l"
-{ SET_TOKEN_STATE('?'); }
-	YY_BREAK
-/* Structural tokens */
-case 60:
-YY_RULE_SETUP
-#line 168 "scanner.l"
-{ SET_TOKEN_STATE(';'); }
-	YY_BREAK
-case 61:
-YY_RULE_SETUP
-#line 169 "scanner.l"
-{ SET_TOKEN_STATE('{'); }
-	YY_BREAK
-case 62:
-YY_RULE_SETUP
-#line 170 "scanner.l"
-{ SET_TOKEN_STATE('}'); }
-	YY_BREAK
-case 63:
-YY_RULE_SETUP
-#line 171 "scanner.l"
-{ SET_TOKEN_STATE(','); }
-	YY_BREAK
-case 64:
-YY_RULE_SETUP
-#line 172 "scanner.l"
-{ SET_TOKEN_STATE(':'); }
-	YY_BREAK
-case 65:
-YY_RULE_SETUP
-#line 173 "scanner.l"
-{ SET_TOKEN_STATE('='); }
-	YY_BREAK
-case 66:
-YY_RULE_SETUP
-#line 174 "scanner.l"
-{ SET_TOKEN_STATE('('); }
-	YY_BREAK
-case 67:
-YY_RULE_SETUP
-#line 175 "scanner.l"
-{ SET_TOKEN_STATE(')'); }
-	YY_BREAK
-case 68:
-YY_RULE_SETUP
-#line 176 "scanner.l"
-{ SET_TOKEN_STATE('['); }
-	YY_BREAK
-case 69:
-YY_RULE_SETUP
-#line 177 "scanner.l"
-{ SET_TOKEN_STATE(']'); }
-	YY_BREAK
-case 70:
-YY_RULE_SETUP
-#line 178 "scanner.l"
-{ SET_TOKEN_STATE('.'); }
-	YY_BREAK
-case 71:
-YY_RULE_SETUP
-#line 181 "scanner.l"
-{ SET_IDENT_STATE(); }
-	YY_BREAK
-/* recognize an integer */
-case 72:
-YY_RULE_SETUP
-#line 184 "scanner.l"
-{ SET_INUM_STATE(); }
-	YY_BREAK
-/* recognize an unsigned number */
-case 73:
-YY_RULE_SETUP
-#line 187 "scanner.l"
-{ SET_UNUM_STATE(); }
-	YY_BREAK
-/* recognize a float */
-case 74:
-YY_RULE_SETUP
-#line 190 "scanner.l"
-{ SET_FNUM_STATE(); }
-	YY_BREAK
-/* double quoted strings have escapes managed */
-case 75:
-YY_RULE_SETUP
-#line 193 "scanner.l"
-{
-        bidx = 0;
-        memset(buffer, 0, sizeof(buffer));
-        BEGIN(DQUOTES);
-    }
-	YY_BREAK
-case 76:
-YY_RULE_SETUP
-#line 199 "scanner.l"
-{ SET_STRG_STATE(); }
-	YY_BREAK
-/* problem is that the short rule matches before the long one does */
-case 77:
-YY_RULE_SETUP
-#line 202 "scanner.l"
-{ append_char('\n'); }
-	YY_BREAK
-case 78:
-YY_RULE_SETUP
-#line 203 "scanner.l"
-{ append_char('\r'); }
-	YY_BREAK
-case 79:
-YY_RULE_SETUP
-#line 204 "scanner.l"
-{ append_char('\t'); }
-	YY_BREAK
-case 80:
-YY_RULE_SETUP
-#line 205 "scanner.l"
-{ append_char('\b'); }
-	YY_BREAK
-case 81:
-YY_RULE_SETUP
-#line 206 "scanner.l"
-{ append_char('\f'); }
-	YY_BREAK
-case 82:
-YY_RULE_SETUP
-#line 207 "scanner.l"
-{ append_char('\v'); }
-	YY_BREAK
-case 83:
-YY_RULE_SETUP
-#line 208 "scanner.l"
-{ append_char('\\'); }
-	YY_BREAK
-case 84:
-YY_RULE_SETUP
-#line 209 "scanner.l"
-{ append_char('\"'); }
-	YY_BREAK
-case 85:
-YY_RULE_SETUP
-#line 210 "scanner.l"
-{ append_char('\''); }
-	YY_BREAK
-case 86:
-YY_RULE_SETUP
-#line 211 "scanner.l"
-{ append_char('\?'); }
-	YY_BREAK
-case 87:
-YY_RULE_SETUP
-#line 212 "scanner.l"
-{ append_char(yytext[1]); }
-	YY_BREAK
-case 88:
-YY_RULE_SETUP
-#line 213 "scanner.l"
-{ append_char((char)strtol(yytext+1, 0, 8));  }
-	YY_BREAK
-case 89:
-YY_RULE_SETUP
-#line 214 "scanner.l"
-{ append_char((char)strtol(yytext+2, 0, 16));  }
-	YY_BREAK
-case 90:
-YY_RULE_SETUP
-#line 215 "scanner.l"
-{ append_str(yytext); }
-	YY_BREAK
-/* single quoted strings are absolute literals */
-case 91:
-YY_RULE_SETUP
-#line 219 "scanner.l"
-{
-        bidx = 0;
-        memset(buffer, 0, sizeof(buffer));
-        BEGIN(SQUOTES);
-    }
-	YY_BREAK
-case 92:
-YY_RULE_SETUP
-#line 225 "scanner.l"
-{ SET_STRG_STATE(); }
-	YY_BREAK
-case 93:
-YY_RULE_SETUP
-#line 227 "scanner.l"
-{ append_str(yytext); }
-	YY_BREAK
-case 94:
-YY_RULE_SETUP
-#line 228 "scanner.l"
-{ append_str(yytext); }
-	YY_BREAK
-/* ignore characters such as '#' */
-case 95:
-YY_RULE_SETUP
-#line 231 "scanner.l"
-{ }
-	YY_BREAK
-case YY_STATE_EOF(INITIAL):
-case YY_STATE_EOF(SQUOTES):
-case YY_STATE_EOF(DQUOTES):
-case YY_STATE_EOF(COMMENT):
-#line 233 "scanner.l"
-{
-
-    if(name_stack != NULL) {
-        DEBUG("closing file \"%s\"", name_stack->name);
-
-        _file_name_stack *name = name_stack->next;
-        yy_delete_buffer(name_stack->state);
-        FREE(name_stack->name);
-        FREE(name_stack);
-        name_stack = name;
-
-        if(name_stack != NULL)
-            yy_switch_to_buffer(name_stack->state);
-        else {
-            DEBUG("calling yyterminate()");
-            yyterminate();
-        }
-        memset(buffer, 0, sizeof(buffer));
-    }
-    else {
-        DEBUG("<<EOF>> with no file open");
-    }
-    DEBUG("file closed");
-    return END_OF_FILE;
-}
-	YY_BREAK
-case 96:
-YY_RULE_SETUP
-#line 260 "scanner.l"
-ECHO;
-	YY_BREAK
-#line 1541 "scanner.c"
-
-	case YY_END_OF_BUFFER:
-		{
-		/* Amount of text matched not including the EOB char. */
-		int yy_amount_of_matched_text = (int) (yy_cp - (yytext_ptr)) - 1;
-
-		/* Undo the effects of YY_DO_BEFORE_ACTION. */
-		*yy_cp = (yy_hold_char);
-		YY_RESTORE_YY_MORE_OFFSET
-
-		if ( YY_CURRENT_BUFFER_LVALUE->yy_buffer_status == YY_BUFFER_NEW )
-			{
-			/* We're scanning a new file or input source.  It's
-			 * possible that this happened because the user
-			 * just pointed yyin at a new source and called
-			 * yylex().  If so, then we have to assure
-			 * consistency between YY_CURRENT_BUFFER and our
-			 * globals.  Here is the right place to do so, because
-			 * this is the first action (other than possibly a
-			 * back-up) that will match for the new input source.
-			 */
-			(yy_n_chars) = YY_CURRENT_BUFFER_LVALUE->yy_n_chars;
-			YY_CURRENT_BUFFER_LVALUE->yy_input_file = yyin;
-			YY_CURRENT_BUFFER_LVALUE->yy_buffer_status = YY_BUFFER_NORMAL;
-			}
-
-		/* Note that here we test for yy_c_buf_p "<=" to the position
-		 * of the first EOB in the buffer, since yy_c_buf_p will
-		 * already have been incremented past the NUL character
-		 * (since all states make transitions on EOB to the
-		 * end-of-buffer state).  Contrast this with the test
-		 * in input().
-		 */
-		if ( (yy_c_buf_p) <= &YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[(yy_n_chars)] )
-			{ /* This was really a NUL. */
-			yy_state_type yy_next_state;
-
-			(yy_c_buf_p) = (yytext_ptr) + yy_amount_of_matched_text;
-
-			yy_current_state = yy_get_previous_state(  );
-
-			/* Okay, we're now positioned to make the NUL
-			 * transition.  We couldn't have
-			 * yy_get_previous_state() go ahead and do it
-			 * for us because it doesn't know how to deal
-			 * with the possibility of jamming (and we don't
-			 * want to build jamming into it because then it
-			 * will run more slowly).
-			 */
-
-			yy_next_state = yy_try_NUL_trans( yy_current_state );
-
-			yy_bp = (yytext_ptr) + YY_MORE_ADJ;
-
-			if ( yy_next_state )
-				{
-				/* Consume the NUL. */
-				yy_cp = ++(yy_c_buf_p);
-				yy_current_state = yy_next_state;
-				goto yy_match;
-				}
-
-			else
-				{
-				yy_cp = (yy_c_buf_p);
-				goto yy_find_action;
-				}
-			}
-
-		else switch ( yy_get_next_buffer(  ) )
-			{
-			case EOB_ACT_END_OF_FILE:
-				{
-				(yy_did_buffer_switch_on_eof) = 0;
-
-				if ( yywrap(  ) )
-					{
-					/* Note: because we've taken care in
-					 * yy_get_next_buffer() to have set up
-					 * yytext, we can now set up
-					 * yy_c_buf_p so that if some total
-					 * hoser (like flex itself) wants to
-					 * call the scanner after we return the
-					 * YY_NULL, it'll still work - another
-					 * YY_NULL will get returned.
-					 */
-					(yy_c_buf_p) = (yytext_ptr) + YY_MORE_ADJ;
-
-					yy_act = YY_STATE_EOF(YY_START);
-					goto do_action;
-					}
-
-				else
-					{
-					if ( ! (yy_did_buffer_switch_on_eof) )
-						YY_NEW_FILE;
-					}
-				break;
-				}
-
-			case EOB_ACT_CONTINUE_SCAN:
-				(yy_c_buf_p) =
-					(yytext_ptr) + yy_amount_of_matched_text;
-
-				yy_current_state = yy_get_previous_state(  );
-
-				yy_cp = (yy_c_buf_p);
-				yy_bp = (yytext_ptr) + YY_MORE_ADJ;
-				goto yy_match;
-
-			case EOB_ACT_LAST_MATCH:
-				(yy_c_buf_p) =
-				&YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[(yy_n_chars)];
-
-				yy_current_state = yy_get_previous_state(  );
-
-				yy_cp = (yy_c_buf_p);
-				yy_bp = (yytext_ptr) + YY_MORE_ADJ;
-				goto yy_find_action;
-			}
-		break;
-		}
-
-	default:
-		YY_FATAL_ERROR(
-			"fatal flex scanner internal error--no action found" );
-	} /* end of action switch */
-		} /* end of scanning one token */
-	} /* end of user's declarations */
-} /* end of yylex */
-
-/* yy_get_next_buffer - try to read in a new buffer
- *
- * Returns a code representing an action:
- *	EOB_ACT_LAST_MATCH -
- *	EOB_ACT_CONTINUE_SCAN - continue scanning from current position
- *	EOB_ACT_END_OF_FILE - end of file
- */
-static int yy_get_next_buffer (void)
-{
-    	char *dest = YY_CURRENT_BUFFER_LVALUE->yy_ch_buf;
-	char *source = (yytext_ptr);
-	int number_to_move, i;
-	int ret_val;
-
-	if ( (yy_c_buf_p) > &YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[(yy_n_chars) + 1] )
-		YY_FATAL_ERROR(
-		"fatal flex scanner internal error--end of buffer missed" );
-
-	if ( YY_CURRENT_BUFFER_LVALUE->yy_fill_buffer == 0 )
-		{ /* Don't try to fill the buffer, so this is an EOF. */
-		if ( (yy_c_buf_p) - (yytext_ptr) - YY_MORE_ADJ == 1 )
-			{
-			/* We matched a single character, the EOB, so
-			 * treat this as a final EOF.
-			 */
-			return EOB_ACT_END_OF_FILE;
-			}
-
-		else
-			{
-			/* We matched some text prior to the EOB, first
-			 * process it.
-			 */
-			return EOB_ACT_LAST_MATCH;
-			}
-		}
-
-	/* Try to read more data. */
-
-	/* First move last chars to start of buffer. */
-	number_to_move = (int) ((yy_c_buf_p) - (yytext_ptr) - 1);
-
-	for ( i = 0; i < number_to_move; ++i )
-		*(dest++) = *(source++);
-
-	if ( YY_CURRENT_BUFFER_LVALUE->yy_buffer_status == YY_BUFFER_EOF_PENDING )
-		/* don't do the read, it's not guaranteed to return an EOF,
-		 * just force an EOF
-		 */
-		YY_CURRENT_BUFFER_LVALUE->yy_n_chars = (yy_n_chars) = 0;
-
-	else
-		{
-			int num_to_read =
-			YY_CURRENT_BUFFER_LVALUE->yy_buf_size - number_to_move - 1;
-
-		while ( num_to_read <= 0 )
-			{ /* Not enough room in the buffer - grow it. */
-
-			/* just a shorter name for the current buffer */
-			YY_BUFFER_STATE b = YY_CURRENT_BUFFER_LVALUE;
-
-			int yy_c_buf_p_offset =
-				(int) ((yy_c_buf_p) - b->yy_ch_buf);
-
-			if ( b->yy_is_our_buffer )
-				{
-				int new_size = b->yy_buf_size * 2;
-
-				if ( new_size <= 0 )
-					b->yy_buf_size += b->yy_buf_size / 8;
-				else
-					b->yy_buf_size *= 2;
-
-				b->yy_ch_buf = (char *)
-					/* Include room in for 2 EOB chars. */
-					yyrealloc( (void *) b->yy_ch_buf,
-							 (yy_size_t) (b->yy_buf_size + 2)  );
-				}
-			else
-				/* Can't grow it, we don't own it. */
-				b->yy_ch_buf = NULL;
-
-			if ( ! b->yy_ch_buf )
-				YY_FATAL_ERROR(
-				"fatal error - scanner input buffer overflow" );
-
-			(yy_c_buf_p) = &b->yy_ch_buf[yy_c_buf_p_offset];
-
-			num_to_read = YY_CURRENT_BUFFER_LVALUE->yy_buf_size -
-						number_to_move - 1;
-
-			}
-
-		if ( num_to_read > YY_READ_BUF_SIZE )
-			num_to_read = YY_READ_BUF_SIZE;
-
-		/* Read in more data. */
-		YY_INPUT( (&YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[number_to_move]),
-			(yy_n_chars), num_to_read );
-
-		YY_CURRENT_BUFFER_LVALUE->yy_n_chars = (yy_n_chars);
-		}
-
-	if ( (yy_n_chars) == 0 )
-		{
-		if ( number_to_move == YY_MORE_ADJ )
-			{
-			ret_val = EOB_ACT_END_OF_FILE;
-			yyrestart( yyin  );
-			}
-
-		else
-			{
-			ret_val = EOB_ACT_LAST_MATCH;
-			YY_CURRENT_BUFFER_LVALUE->yy_buffer_status =
-				YY_BUFFER_EOF_PENDING;
-			}
-		}
-
-	else
-		ret_val = EOB_ACT_CONTINUE_SCAN;
-
-	if (((yy_n_chars) + number_to_move) > YY_CURRENT_BUFFER_LVALUE->yy_buf_size) {
-		/* Extend the array by 50%, plus the number we really need. */
-		int new_size = (yy_n_chars) + number_to_move + ((yy_n_chars) >> 1);
-		YY_CURRENT_BUFFER_LVALUE->yy_ch_buf = (char *) yyrealloc(
-			(void *) YY_CURRENT_BUFFER_LVALUE->yy_ch_buf, (yy_size_t) new_size  );
-		if ( ! YY_CURRENT_BUFFER_LVALUE->yy_ch_buf )
-			YY_FATAL_ERROR( "out of dynamic memory in yy_get_next_buffer()" );
-		/* "- 2" to take care of EOB's */
-		YY_CURRENT_BUFFER_LVALUE->yy_buf_size = (int) (new_size - 2);
-	}
-
-	(yy_n_chars) += number_to_move;
-	YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[(yy_n_chars)] = YY_END_OF_BUFFER_CHAR;
-	YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[(yy_n_chars) + 1] = YY_END_OF_BUFFER_CHAR;
-
-	(yytext_ptr) = &YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[0];
-
-	return ret_val;
-}
-
-/* yy_get_previous_state - get the state just before the EOB char was reached */
-
-    static yy_state_type yy_get_previous_state (void)
-{
-	yy_state_type yy_current_state;
-	char *yy_cp;
-    
-	yy_current_state = (yy_start);
-
-	for ( yy_cp = (yytext_ptr) + YY_MORE_ADJ; yy_cp < (yy_c_buf_p); ++yy_cp )
-		{
-		YY_CHAR yy_c = (*yy_cp ? yy_ec[YY_SC_TO_UI(*yy_cp)] : 1);
-		if ( yy_accept[yy_current_state] )
-			{
-			(yy_last_accepting_state) = yy_current_state;
-			(yy_last_accepting_cpos) = yy_cp;
-			}
-		while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
-			{
-			yy_current_state = (int) yy_def[yy_current_state];
-			if ( yy_current_state >= 236 )
-				yy_c = yy_meta[yy_c];
-			}
-		yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
-		}
-
-	return yy_current_state;
-}
-
-/* yy_try_NUL_trans - try to make a transition on the NUL character
- *
- * synopsis
- *	next_state = yy_try_NUL_trans( current_state );
- */
-    static yy_state_type yy_try_NUL_trans  (yy_state_type yy_current_state )
-{
-	int yy_is_jam;
-    	char *yy_cp = (yy_c_buf_p);
-
-	YY_CHAR yy_c = 1;
-	if ( yy_accept[yy_current_state] )
-		{
-		(yy_last_accepting_state) = yy_current_state;
-		(yy_last_accepting_cpos) = yy_cp;
-		}
-	while ( yy_chk[yy_base[yy_current_state] + yy_c] != yy_current_state )
-		{
-		yy_current_state = (int) yy_def[yy_current_state];
-		if ( yy_current_state >= 236 )
-			yy_c = yy_meta[yy_c];
-		}
-	yy_current_state = yy_nxt[yy_base[yy_current_state] + yy_c];
-	yy_is_jam = (yy_current_state == 235);
-
-		return yy_is_jam ? 0 : yy_current_state;
-}
-
-#ifndef YY_NO_UNPUT
-
-#endif
-
-#ifndef YY_NO_INPUT
-#ifdef __cplusplus
-    static int yyinput (void)
-#else
-    static int input  (void)
-#endif
-
-{
-	int c;
-    
-	*(yy_c_buf_p) = (yy_hold_char);
-
-	if ( *(yy_c_buf_p) == YY_END_OF_BUFFER_CHAR )
-		{
-		/* yy_c_buf_p now points to the character we want to return.
-		 * If this occurs *before* the EOB characters, then it's a
-		 * valid NUL; if not, then we've hit the end of the buffer.
-		 */
-		if ( (yy_c_buf_p) < &YY_CURRENT_BUFFER_LVALUE->yy_ch_buf[(yy_n_chars)] )
-			/* This was really a NUL. */
-			*(yy_c_buf_p) = '\0';
-
-		else
-			{ /* need more input */
-			int offset = (int) ((yy_c_buf_p) - (yytext_ptr));
-			++(yy_c_buf_p);
-
-			switch ( yy_get_next_buffer(  ) )
-				{
-				case EOB_ACT_LAST_MATCH:
-					/* This happens because yy_g_n_b()
-					 * sees that we've accumulated a
-					 * token and flags that we need to
-					 * try matching the token before
-					 * proceeding.  But for input(),
-					 * there's no matching to consider.
-					 * So convert the EOB_ACT_LAST_MATCH
-					 * to EOB_ACT_END_OF_FILE.
-					 */
-
-					/* Reset buffer status. */
-					yyrestart( yyin );
-
-					/*FALLTHROUGH*/
-
-				case EOB_ACT_END_OF_FILE:
-					{
-					if ( yywrap(  ) )
-						return 0;
-
-					if ( ! (yy_did_buffer_switch_on_eof) )
-						YY_NEW_FILE;
-#ifdef __cplusplus
-					return yyinput();
-#else
-					return input();
-#endif
-					}
-
-				case EOB_ACT_CONTINUE_SCAN:
-					(yy_c_buf_p) = (yytext_ptr) + offset;
-					break;
-				}
-			}
-		}
-
-	c = *(unsigned char *) (yy_c_buf_p);	/* cast for 8-bit char's */
-	*(yy_c_buf_p) = '\0';	/* preserve yytext */
-	(yy_hold_char) = *++(yy_c_buf_p);
-
-	if ( c == '\n' )
-		
-    yylineno++;
-;
-
-	return c;
-}
-#endif	/* ifndef YY_NO_INPUT */
-
-/** Immediately switch to a different input stream.
- * @param input_file A readable stream.
- * 
- * @note This function does not reset the start condition to @c INITIAL .
- */
-    void yyrestart  (FILE * input_file )
-{
-    
-	if ( ! YY_CURRENT_BUFFER ){
-        yyensure_buffer_stack ();
-		YY_CURRENT_BUFFER_LVALUE =
-            yy_create_buffer( yyin, YY_BUF_SIZE );
-	}
-
-	yy_init_buffer( YY_CURRENT_BUFFER, input_file );
-	yy_load_buffer_state(  );
-}
-
-/** Switch to a different input buffer.
- * @param new_buffer The new input buffer.
- * 
- */
-    void yy_switch_to_buffer  (YY_BUFFER_STATE  new_buffer )
-{
-    
-	/* TODO. We should be able to replace this entire function body
-	 * with
-	 *		yypop_buffer_state();
-	 *		yypush_buffer_state(new_buffer);
-     */
-	yyensure_buffer_stack ();
-	if ( YY_CURRENT_BUFFER == new_buffer )
-		return;
-
-	if ( YY_CURRENT_BUFFER )
-		{
-		/* Flush out information for old buffer. */
-		*(yy_c_buf_p) = (yy_hold_char);
-		YY_CURRENT_BUFFER_LVALUE->yy_buf_pos = (yy_c_buf_p);
-		YY_CURRENT_BUFFER_LVALUE->yy_n_chars = (yy_n_chars);
-		}
-
-	YY_CURRENT_BUFFER_LVALUE = new_buffer;
-	yy_load_buffer_state(  );
-
-	/* We don't actually know whether we did this switch during
-	 * EOF (yywrap()) processing, but the only time this flag
-	 * is looked at is after yywrap() is called, so it's safe
-	 * to go ahead and always set it.
-	 */
-	(yy_did_buffer_switch_on_eof) = 1;
-}
-
-static void yy_load_buffer_state  (void)
-{
-    	(yy_n_chars) = YY_CURRENT_BUFFER_LVALUE->yy_n_chars;
-	(yytext_ptr) = (yy_c_buf_p) = YY_CURRENT_BUFFER_LVALUE->yy_buf_pos;
-	yyin = YY_CURRENT_BUFFER_LVALUE->yy_input_file;
-	(yy_hold_char) = *(yy_c_buf_p);
-}
-
-/** Allocate and initialize an input buffer state.
- * @param file A readable stream.
- * @param size The character buffer size in bytes. When in doubt, use @c YY_BUF_SIZE.
- * 
- * @return the allocated buffer state.
- */
-    YY_BUFFER_STATE yy_create_buffer  (FILE * file, int  size )
-{
-	YY_BUFFER_STATE b;
-    
-	b = (YY_BUFFER_STATE) yyalloc( sizeof( struct yy_buffer_state )  );
-	if ( ! b )
-		YY_FATAL_ERROR( "out of dynamic memory in yy_create_buffer()" );
-
-	b->yy_buf_size = size;
-
-	/* yy_ch_buf has to be 2 characters longer than the size given because
-	 * we need to put in 2 end-of-buffer characters.
-	 */
-	b->yy_ch_buf = (char *) yyalloc( (yy_size_t) (b->yy_buf_size + 2)  );
-	if ( ! b->yy_ch_buf )
-		YY_FATAL_ERROR( "out of dynamic memory in yy_create_buffer()" );
-
-	b->yy_is_our_buffer = 1;
-
-	yy_init_buffer( b, file );
-
-	return b;
-}
-
-/** Destroy the buffer.
- * @param b a buffer created with yy_create_buffer()
- * 
- */
-    void yy_delete_buffer (YY_BUFFER_STATE  b )
-{
-    
-	if ( ! b )
-		return;
-
-	if ( b == YY_CURRENT_BUFFER ) /* Not sure if we should pop here. */
-		YY_CURRENT_BUFFER_LVALUE = (YY_BUFFER_STATE) 0;
-
-	if ( b->yy_is_our_buffer )
-		yyfree( (void *) b->yy_ch_buf  );
-
-	yyfree( (void *) b  );
-}
-
-/* Initializes or reinitializes a buffer.
- * This function is sometimes called more than once on the same buffer,
- * such as during a yyrestart() or at EOF.
- */
-    static void yy_init_buffer  (YY_BUFFER_STATE  b, FILE * file )
-
-{
-	int oerrno = errno;
-    
-	yy_flush_buffer( b );
-
-	b->yy_input_file = file;
-	b->yy_fill_buffer = 1;
-
-    /* If b is the current buffer, then yy_init_buffer was _probably_
-     * called from yyrestart() or through yy_get_next_buffer.
-     * In that case, we don't want to reset the lineno or column.
-     */
-    if (b != YY_CURRENT_BUFFER){
-        b->yy_bs_lineno = 1;
-        b->yy_bs_column = 0;
-    }
-
-        b->yy_is_interactive = file ? (isatty( fileno(file) ) > 0) : 0;
-    
-	errno = oerrno;
-}
-
-/** Discard all buffered characters. On the next scan, YY_INPUT will be called.
- * @param b the buffer state to be flushed, usually @c YY_CURRENT_BUFFER.
- * 
- */
-    void yy_flush_buffer (YY_BUFFER_STATE  b )
-{
-    	if ( ! b )
-		return;
-
-	b->yy_n_chars = 0;
-
-	/* We always need two end-of-buffer characters.  The first causes
-	 * a transition to the end-of-buffer state.  The second causes
-	 * a jam in that state.
-	 */
-	b->yy_ch_buf[0] = YY_END_OF_BUFFER_CHAR;
-	b->yy_ch_buf[1] = YY_END_OF_BUFFER_CHAR;
-
-	b->yy_buf_pos = &b->yy_ch_buf[0];
-
-	b->yy_at_bol = 1;
-	b->yy_buffer_status = YY_BUFFER_NEW;
-
-	if ( b == YY_CURRENT_BUFFER )
-		yy_load_buffer_state(  );
-}
-
-/** Pushes the new state onto the stack. The new state becomes
- *  the current state. This function will allocate the stack
- *  if necessary.
- *  @param new_buffer The new state.
- *  
- */
-void yypush_buffer_state (YY_BUFFER_STATE new_buffer )
-{
-    	if (new_buffer == NULL)
-		return;
-
-	yyensure_buffer_stack();
-
-	/* This block is copied from yy_switch_to_buffer. */
-	if ( YY_CURRENT_BUFFER )
-		{
-		/* Flush out information for old buffer. */
-		*(yy_c_buf_p) = (yy_hold_char);
-		YY_CURRENT_BUFFER_LVALUE->yy_buf_pos = (yy_c_buf_p);
-		YY_CURRENT_BUFFER_LVALUE->yy_n_chars = (yy_n_chars);
-		}
-
-	/* Only push if top exists. Otherwise, replace top. */
-	if (YY_CURRENT_BUFFER)
-		(yy_buffer_stack_top)++;
-	YY_CURRENT_BUFFER_LVALUE = new_buffer;
-
-	/* copied from yy_switch_to_buffer. */
-	yy_load_buffer_state(  );
-	(yy_did_buffer_switch_on_eof) = 1;
-}
-
-/** Removes and deletes the top of the stack, if present.
- *  The next element becomes the new top.
- *  
- */
-void yypop_buffer_state (void)
-{
-    	if (!YY_CURRENT_BUFFER)
-		return;
-
-	yy_delete_buffer(YY_CURRENT_BUFFER );
-	YY_CURRENT_BUFFER_LVALUE = NULL;
-	if ((yy_buffer_stack_top) > 0)
-		--(yy_buffer_stack_top);
-
-	if (YY_CURRENT_BUFFER) {
-		yy_load_buffer_state(  );
-		(yy_did_buffer_switch_on_eof) = 1;
-	}
-}
-
-/* Allocates the stack if it does not exist.
- *  Guarantees space for at least one push.
- */
-static void yyensure_buffer_stack (void)
-{
-	yy_size_t num_to_alloc;
-    
-	if (!(yy_buffer_stack)) {
-
-		/* First allocation is just for 2 elements, since we don't know if this
-		 * scanner will even need a stack. We use 2 instead of 1 to avoid an
-		 * immediate realloc on the next call.
-         */
-      num_to_alloc = 1; /* After all that talk, this was set to 1 anyways... */
-		(yy_buffer_stack) = (struct yy_buffer_state**)yyalloc
-								(num_to_alloc * sizeof(struct yy_buffer_state*)
-								);
-		if ( ! (yy_buffer_stack) )
-			YY_FATAL_ERROR( "out of dynamic memory in yyensure_buffer_stack()" );
-
-		memset((yy_buffer_stack), 0, num_to_alloc * sizeof(struct yy_buffer_state*));
-
-		(yy_buffer_stack_max) = num_to_alloc;
-		(yy_buffer_stack_top) = 0;
-		return;
-	}
-
-	if ((yy_buffer_stack_top) >= ((yy_buffer_stack_max)) - 1){
-
-		/* Increase the buffer to prepare for a possible push. */
-		yy_size_t grow_size = 8 /* arbitrary grow size */;
-
-		num_to_alloc = (yy_buffer_stack_max) + grow_size;
-		(yy_buffer_stack) = (struct yy_buffer_state**)yyrealloc
-								((yy_buffer_stack),
-								num_to_alloc * sizeof(struct yy_buffer_state*)
-								);
-		if ( ! (yy_buffer_stack) )
-			YY_FATAL_ERROR( "out of dynamic memory in yyensure_buffer_stack()" );
-
-		/* zero only the new slots.*/
-		memset((yy_buffer_stack) + (yy_buffer_stack_max), 0, grow_size * sizeof(struct yy_buffer_state*));
-		(yy_buffer_stack_max) = num_to_alloc;
-	}
-}
-
-/** Setup the input buffer state to scan directly from a user-specified character buffer.
- * @param base the character buffer
- * @param size the size in bytes of the character buffer
- * 
- * @return the newly allocated buffer state object.
- */
-YY_BUFFER_STATE yy_scan_buffer  (char * base, yy_size_t  size )
-{
-	YY_BUFFER_STATE b;
-    
-	if ( size < 2 ||
-	     base[size-2] != YY_END_OF_BUFFER_CHAR ||
-	     base[size-1] != YY_END_OF_BUFFER_CHAR )
-		/* They forgot to leave room for the EOB's. */
-		return NULL;
-
-	b = (YY_BUFFER_STATE) yyalloc( sizeof( struct yy_buffer_state )  );
-	if ( ! b )
-		YY_FATAL_ERROR( "out of dynamic memory in yy_scan_buffer()" );
-
-	b->yy_buf_size = (int) (size - 2);	/* "- 2" to take care of EOB's */
-	b->yy_buf_pos = b->yy_ch_buf = base;
-	b->yy_is_our_buffer = 0;
-	b->yy_input_file = NULL;
-	b->yy_n_chars = b->yy_buf_size;
-	b->yy_is_interactive = 0;
-	b->yy_at_bol = 1;
-	b->yy_fill_buffer = 0;
-	b->yy_buffer_status = YY_BUFFER_NEW;
-
-	yy_switch_to_buffer( b  );
-
-	return b;
-}
-
-/** Setup the input buffer state to scan a string. The next call to yylex() will
- * scan from a @e copy of @a str.
- * @param yystr a NUL-terminated string to scan
- * 
- * @return the newly allocated buffer state object.
- * @note If you want to scan bytes that may contain NUL values, then use
- *       yy_scan_bytes() instead.
- */
-YY_BUFFER_STATE yy_scan_string (const char * yystr )
-{
-    
-	return yy_scan_bytes( yystr, (int) strlen(yystr) );
-}
-
-/** Setup the input buffer state to scan the given bytes. The next call to yylex() will
- * scan from a @e copy of @a bytes.
- * @param yybytes the byte buffer to scan
- * @param _yybytes_len the number of bytes in the buffer pointed to by @a bytes.
- * 
- * @return the newly allocated buffer state object.
- */
-YY_BUFFER_STATE yy_scan_bytes  (const char * yybytes, int  _yybytes_len )
-{
-	YY_BUFFER_STATE b;
-	char *buf;
-	yy_size_t n;
-	int i;
-    
-	/* Get memory for full buffer, including space for trailing EOB's. */
-	n = (yy_size_t) (_yybytes_len + 2);
-	buf = (char *) yyalloc( n  );
-	if ( ! buf )
-		YY_FATAL_ERROR( "out of dynamic memory in yy_scan_bytes()" );
-
-	for ( i = 0; i < _yybytes_len; ++i )
-		buf[i] = yybytes[i];
-
-	buf[_yybytes_len] = buf[_yybytes_len+1] = YY_END_OF_BUFFER_CHAR;
-
-	b = yy_scan_buffer( buf, n );
-	if ( ! b )
-		YY_FATAL_ERROR( "bad buffer in yy_scan_bytes()" );
-
-	/* It's okay to grow etc. this buffer, and we should throw it
-	 * away when we're done.
-	 */
-	b->yy_is_our_buffer = 1;
-
-	return b;
-}
-
-#ifndef YY_EXIT_FAILURE
-#define YY_EXIT_FAILURE 2
-#endif
-
-static void yynoreturn yy_fatal_error (const char* msg )
-{
-			fprintf( stderr, "%s\n", msg );
-	exit( YY_EXIT_FAILURE );
-}
-
-/* Redefine yyless() so it works in section 3 code. */
-
-#undef yyless
-#define yyless(n) \
-	do \
-		{ \
-		/* Undo effects of setting up yytext. */ \
-        int yyless_macro_arg = (n); \
-        YY_LESS_LINENO(yyless_macro_arg);\
-		yytext[yyleng] = (yy_hold_char); \
-		(yy_c_buf_p) = yytext + yyless_macro_arg; \
-		(yy_hold_char) = *(yy_c_buf_p); \
-		*(yy_c_buf_p) = '\0'; \
-		yyleng = yyless_macro_arg; \
-		} \
-	while ( 0 )
-
-/* Accessor  methods (get/set functions) to struct members. */
-
-/** Get the current line number.
- * 
- */
-int yyget_lineno  (void)
-{
-    
-    return yylineno;
-}
-
-/** Get the input stream.
- * 
- */
-FILE *yyget_in  (void)
-{
-        return yyin;
-}
-
-/** Get the output stream.
- * 
- */
-FILE *yyget_out  (void)
-{
-        return yyout;
-}
-
-/** Get the length of the current token.
- * 
- */
-int yyget_leng  (void)
-{
-        return yyleng;
-}
-
-/** Get the current token.
- * 
- */
-
-char *yyget_text  (void)
-{
-        return yytext;
-}
-
-/** Set the current line number.
- * @param _line_number line number
- * 
- */
-void yyset_lineno (int  _line_number )
-{
-    
-    yylineno = _line_number;
-}
-
-/** Set the input stream. This does not discard the current
- * input buffer.
- * @param _in_str A readable stream.
- * 
- * @see yy_switch_to_buffer
- */
-void yyset_in (FILE *  _in_str )
-{
-        yyin = _in_str ;
-}
-
-void yyset_out (FILE *  _out_str )
-{
-        yyout = _out_str ;
-}
-
-int yyget_debug  (void)
-{
-        return yy_flex_debug;
-}
-
-void yyset_debug (int  _bdebug )
-{
-        yy_flex_debug = _bdebug ;
-}
-
-static int yy_init_globals (void)
-{
-        /* Initialization is the same as for the non-reentrant scanner.
-     * This function is called from yylex_destroy(), so don't allocate here.
-     */
-
-    /* We do not touch yylineno unless the option is enabled. */
-    yylineno =  1;
-    
-    (yy_buffer_stack) = NULL;
-    (yy_buffer_stack_top) = 0;
-    (yy_buffer_stack_max) = 0;
-    (yy_c_buf_p) = NULL;
-    (yy_init) = 0;
-    (yy_start) = 0;
-
-/* Defined in main.c */
-#ifdef YY_STDINIT
-    yyin = stdin;
-    yyout = stdout;
-#else
-    yyin = NULL;
-    yyout = NULL;
-#endif
-
-    /* For future reference: Set errno on error, since we are called by
-     * yylex_init()
-     */
-    return 0;
-}
-
-/* yylex_destroy is for both reentrant and non-reentrant scanners. */
-int yylex_destroy  (void)
-{
-    
-    /* Pop the buffer stack, destroying each element. */
-	while(YY_CURRENT_BUFFER){
-		yy_delete_buffer( YY_CURRENT_BUFFER  );
-		YY_CURRENT_BUFFER_LVALUE = NULL;
-		yypop_buffer_state();
-	}
-
-	/* Destroy the stack itself. */
-	yyfree((yy_buffer_stack) );
-	(yy_buffer_stack) = NULL;
-
-    /* Reset the globals. This is important in a non-reentrant scanner so the next time
-     * yylex() is called, initialization will occur. */
-    yy_init_globals( );
-
-    return 0;
-}
-
-/*
- * Internal utility routines.
- */
-
-#ifndef yytext_ptr
-static void yy_flex_strncpy (char* s1, const char * s2, int n )
-{
-		
-	int i;
-	for ( i = 0; i < n; ++i )
-		s1[i] = s2[i];
-}
-#endif
-
-#ifdef YY_NEED_STRLEN
-static int yy_flex_strlen (const char * s )
-{
-	int n;
-	for ( n = 0; s[n]; ++n )
-		;
-
-	return n;
-}
-#endif
-
-void *yyalloc (yy_size_t  size )
-{
-			return malloc(size);
-}
-
-void *yyrealloc  (void * ptr, yy_size_t  size )
-{
-		
-	/* The cast to (char *) in the following accommodates both
-	 * implementations that use char* generic pointers, and those
-	 * that use void* generic pointers.  It works with the latter
-	 * because both ANSI C and C++ allow castless assignment from
-	 * any pointer type to void*, and deal with argument conversions
-	 * as though doing an assignment.
-	 */
-	return realloc(ptr, size);
-}
-
-void yyfree (void * ptr )
-{
-			free( (char *) ptr );	/* see yyrealloc() for (char *) cast */
-}
-
-#define YYTABLES_NAME "yytables"
-
-#line 260 "scanner.l"
-
-
-void open_file(const char *fname) {
-
-    _file_name_stack *name;
-    char* infile = (char*)find_import_file(fname);
-
-    DEBUG("opening file: \"%s\"", infile);
-    if(NULL == (name = CALLOC(1, sizeof(_file_name_stack))))
-        scanner_error("cannot allocate memory for file stack");
-
-    yyin = fopen(infile, "r");
-    if(NULL == yyin) {
-        scanner_error("cannot open the input file: \"%s\": %s", fname, strerror(errno));
-        exit(1);
-    }
-
-    name->next = name_stack;
-    name->name = infile;
-    name->state = yy_create_buffer(yyin, YY_BUF_SIZE);
-    name_stack = name;
-    yy_switch_to_buffer(name_stack->state);
-}
-
-// these funcs support the string scanner
-void append_char(char ch) {
-
-    if((sizeof(buffer)-1) > (size_t)bidx) {
-        buffer[bidx] = ch;
-        bidx++;
-    }
-    else {
-        scanner_error("buffer overrun");
-    }
-}
-
-void append_str(char *str) {
-
-    if((sizeof(buffer)-1) > (strlen(buffer) + strlen(str))) {
-        strcat(buffer, str);
-        bidx = strlen(buffer);
-    }
-    else {
-        scanner_error("buffer overrun");
-    }
-}
-
-void update_loc(void) {
-
-    if(name_stack == NULL)
-        return;
-
-    for(char *s = yytext; *s != '\0'; s++) {
-        name_stack->state->yy_bs_column++;
-    }
-
-}
-
-// Tracking and global interface
-char *get_file_name(void) {
-    if(NULL != name_stack)
-        return name_stack->name;
-    else
-        return "no open file";
-}
-
-int get_line_number(void) {
-    if(NULL != name_stack)
-        return name_stack->state->yy_bs_lineno;
-    else
-        return -1;
-}
-
-int get_col_number(void) {
-    if(NULL != name_stack)
-        return name_stack->state->yy_bs_column;
-    else
-        return -1;
-}
-
-/*
- * Return the token and copy the string that formed it if the parameter
- * is not NULL.
- */
-int get_token(scanner_state_t* ss) {
-
-    DEBUG("get_token(): file stack pointer: %p", name_stack);
-    if(name_stack == NULL) {
-        if(ss != NULL) {
-            //memcpy((void*)ss, (void*)&scanner_state, sizeof(scanner_state_t));
-            memset(ss, 0, sizeof(scanner_state_t));
-            ss->token = END_OF_INPUT;
-        }
-        DEBUG("end token = %s", tok_to_strg(END_OF_INPUT));
-        return END_OF_INPUT;
-    }
-
-    memset(buffer, 0, sizeof(buffer));
-    memset(ss, 0, sizeof(scanner_state_t));
-    int tok = yylex();
-    if(tok == 0)
-        tok = END_OF_INPUT;
-    debug(10, "get_token() token = %s", tok_to_strg(tok));
-
-    DEBUG("scanner ptr = %p", ss);
-    if(ss != NULL) {
-        memcpy((void*)ss, (void*)&scanner_state, sizeof(scanner_state_t));
-    }
-
-    return tok;
-}
-
-/*
- * Check the symbol table to discover if this is a defined type.
- */
-int check_type(void) {
-/*
-* pseudo code --- this is what it should check
-*
-*   if (yytext == type_name)
-*       return(NAMED_TYPE);
-*
-*   return(IDENTIFIER);
-*/
-
-/*
-*   it actually will only return IDENTIFIER
-*/
-
-    return(IDENTIFIER);
-}
-
-
@@ -0,0 +1,263 @@
+/*
+ * Token streams that are saved between runs.
+ *
+ * A module that is imported by many files is scanned every time that it is
+ * imported. When a cache directory is given, the tokens of every file that is
+ * scanned are written there under a hash of the text of the file, and the
+ * next time a file with the same text is opened, the tokens are read back
+ * from the cache instead of being scanned.
+ *
+ * A cache file is a header, the records, and then the string pool. It is
+ * mapped as it is, so there is nothing to decode when it is used. The records
+ * are checked against the sizes of the text and the pool when it is mapped.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "internal.h"
+
+#define CACHE_MAGIC "SIMPTOK"
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;     // number of records
+    uint64_t hash;      // of the source text
+    uint64_t size;      // of the source text
+    uint32_t pool_len;
+    uint32_t reserved;
+} cache_header_t;
+
+#define FNV_OFFSET  0xcbf29ce484222325UL
+#define FNV_PRIME   0x00000100000001b3UL
+
+/*
+ * FNV-1a, taken eight bytes at a time, with the cache version mixed in at
+ * the end.
+ */
+uint64_t hash_text(const char* text, size_t size) {
+
+    uint64_t hash = FNV_OFFSET;
+    uint64_t word;
+    size_t i;
+
+    for(i = 0; i + 8 <= size; i += 8) {
+        memcpy(&word, text + i, 8);
+        hash = (hash ^ word) * FNV_PRIME;
+    }
+    for(; i < size; i++)
+        hash = (hash ^ (uint8_t)text[i]) * FNV_PRIME;
+
+    hash = (hash ^ TOKEN_CACHE_VERSION) * FNV_PRIME;
+    return hash;
+}
+
+static void cache_name(char* buf, size_t len, const char* dir, uint64_t hash) {
+
+    snprintf(buf, len, "%s/%016lx.tok", dir, (unsigned long)hash);
+}
+
+/*
+ * Check that every record points inside the text and the string pool, so that
+ * a file that was cut short or damaged is never read past its end. This is
+ * done once, when the file is mapped, so replaying a token checks nothing.
+ */
+static int check_records(const token_record_t* recs, uint32_t count,
+                    const char* pool, uint32_t pool_len, size_t size) {
+
+    for(uint32_t i = 0; i < count; i++) {
+        const token_record_t* rec = &recs[i];
+        if((uint64_t)rec->offset + rec->length > size)
+            return -1;
+        if(rec->kind == STRING_LITERAL) {
+            // the string and its terminator are in the pool
+            if((uint64_t)rec->value.str.offset + rec->value.str.len >= pool_len ||
+                    pool[rec->value.str.offset + rec->value.str.len] != '\0')
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Map the cache file for the hash that has been set. Returns 0 if the file
+ * is there and fits the text, otherwise returns -1 and the file has to be
+ * scanned.
+ */
+int load_token_cache(token_cache_t* cache, const char* dir, size_t size) {
+
+    char name[1024];
+    struct stat st;
+
+    cache_name(name, sizeof(name), dir, cache->hash);
+    int fd = open(name, O_RDONLY);
+    if(fd < 0)
+        return -1;
+
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(cache_header_t)) {
+        close(fd);
+        return -1;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return -1;
+
+    cache_header_t* head = map;
+    size_t need = sizeof(cache_header_t) + (size_t)head->count * sizeof(token_record_t) + head->pool_len;
+    if(memcmp(head->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) ||
+            head->version != TOKEN_CACHE_VERSION ||
+            head->hash != cache->hash ||
+            head->size != size ||
+            need != (size_t)st.st_size) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    const token_record_t* recs = (const token_record_t*)(head + 1);
+    const char* pool = (const char*)(recs + head->count);
+    if(check_records(recs, head->count, pool, head->pool_len, size)) {
+        warning("the token cache \"%s\" is damaged and is not used", name);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    cache->map = map;
+    cache->map_len = st.st_size;
+    cache->recs = recs;
+    cache->pool = pool;
+    cache->count = head->count;
+    cache->pos = 0;
+
+    DEBUG("replaying %u tokens from \"%s\"", cache->count, name);
+    return 0;
+}
+
+/*
+ * Give the next token from the cache. Returns the token, or zero at the end
+ * of the stream, the same as the scanners do. A number literal that did not
+ * fit when it was scanned is given back the same way, so it is warned about
+ * again. A string literal is copied into the strings of the scanner, because
+ * the cache file is unmapped when the file is closed.
+ */
+int replay_token(_file_name_stack* file, arena_t* strings, token_slice_t* tok, int* out_of_range) {
+
+    token_cache_t* cache = &file->cache;
+
+    if(cache->pos >= cache->count)
+        return 0;
+
+    const token_record_t* rec = &cache->recs[cache->pos++];
+
+    memset(tok, 0, sizeof(token_slice_t));
+    tok->kind = rec->kind;
+    tok->offset = rec->offset;
+    tok->length = rec->length;
+    tok->text = file->text.base + rec->offset;
+    *out_of_range = rec->out_of_range;
+    if(rec->kind == STRING_LITERAL) {
+        tok->value.str.ptr = arena_strndup(strings, cache->pool + rec->value.str.offset, rec->value.str.len);
+        tok->value.str.len = rec->value.str.len;
+    }
+    else
+        memcpy(&tok->value, &rec->value, sizeof(rec->value));
+
+    return tok->kind;
+}
+
+/*
+ * Add a token that was just scanned to the stream that will be saved.
+ */
+void record_token(token_cache_t* cache, token_slice_t* tok, int out_of_range) {
+
+    if(cache->out_count >= cache->out_cap) {
+        cache->out_cap = (cache->out_cap == 0)? 1024: cache->out_cap * 2;
+        cache->out = REALLOC(cache->out, cache->out_cap * sizeof(token_record_t));
+    }
+
+    token_record_t* rec = &cache->out[cache->out_count++];
+
+    memset(rec, 0, sizeof(token_record_t));
+    rec->kind = tok->kind;
+    rec->offset = tok->offset;
+    rec->length = tok->length;
+    rec->out_of_range = out_of_range;
+    if(tok->kind == STRING_LITERAL) {
+        // the strings are kept with a terminator, like the literal buffer
+        size_t len = tok->value.str.len;
+        while(cache->pool_len + len + 1 > cache->pool_cap) {
+            cache->pool_cap = (cache->pool_cap == 0)? 1024: cache->pool_cap * 2;
+            cache->out_pool = REALLOC(cache->out_pool, cache->pool_cap);
+        }
+        memcpy(cache->out_pool + cache->pool_len, tok->value.str.ptr, len);
+        cache->out_pool[cache->pool_len + len] = '\0';
+        rec->value.str.offset = cache->pool_len;
+        rec->value.str.len = len;
+        cache->pool_len += len + 1;
+    }
+    else
+        memcpy(&rec->value, &tok->value, sizeof(rec->value));
+}
+
+static uint32_t temp_count = 0;
+
+/*
+ * Write the recorded stream. It is written to a temporary name and renamed, so
+ * a run that is reading the cache at the same time never sees half of a file.
+ * The temporary name has a count in it as well as the process, so threads that
+ * save the same file do not write into each other. Not being able to write the
+ * cache is not an error.
+ */
+void save_token_cache(token_cache_t* cache, const char* dir, size_t size) {
+
+    char name[1024];
+    char tmp[1100];
+    cache_header_t head;
+
+    mkdir(dir, 0777);
+    cache_name(name, sizeof(name), dir, cache->hash);
+    snprintf(tmp, sizeof(tmp), "%s.%d.%u", name, (int)getpid(),
+                __atomic_add_fetch(&temp_count, 1, __ATOMIC_RELAXED));
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    head.version = TOKEN_CACHE_VERSION;
+    head.count = cache->out_count;
+    head.hash = cache->hash;
+    head.size = size;
+    head.pool_len = cache->pool_len;
+
+    FILE* fp = fopen(tmp, "wb");
+    if(fp == NULL) {
+        warning("cannot write the token cache \"%s\": %s", tmp, strerror(errno));
+        return;
+    }
+
+    int ok = fwrite(&head, sizeof(head), 1, fp) == 1;
+    if(cache->out_count > 0)
+        ok = ok && fwrite(cache->out, sizeof(token_record_t), cache->out_count, fp) == cache->out_count;
+    if(cache->pool_len > 0)
+        ok = ok && fwrite(cache->out_pool, 1, cache->pool_len, fp) == cache->pool_len;
+
+    if(fclose(fp) != 0 || !ok || rename(tmp, name) != 0) {
+        warning("cannot write the token cache \"%s\": %s", name, strerror(errno));
+        unlink(tmp);
+        return;
+    }
+
+    DEBUG("saved %u tokens to \"%s\"", cache->out_count, name);
+}
+
+void free_token_cache(token_cache_t* cache) {
+
+    if(cache->map != NULL)
+        munmap(cache->map, cache->map_len);
+    if(cache->out != NULL)
+        FREE(cache->out);
+    if(cache->out_pool != NULL)
+        FREE(cache->out_pool);
+    memset(cache, 0, sizeof(token_cache_t));
+}
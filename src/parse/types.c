@@ -6,7 +6,7 @@
  * If the token and symbol have been defined as a type, return 1,
  * else return 0. Look the symbol up in the symbol table.
  */
-int is_defined_type(scanner_state_t* ss) {
+int is_defined_type(token_slice_t* tok) {
 
     return 0;
 }
@@ -14,9 +14,9 @@ int is_defined_type(scanner_state_t* ss) {
 /*
  * If the token defined a type, then return 1, esle return 0
  */
-int is_type(scanner_state_t* ss) {
+int is_type(token_slice_t* tok) {
 
-    switch(ss->token) {
+    switch(tok->kind) {
         case FLOAT:
         case INT:
         case UINT:
@@ -27,7 +27,7 @@ int is_type(scanner_state_t* ss) {
         case STRUCT:
             return 1;
         case IDENTIFIER:
-            if(is_defined_type(ss))
+            if(is_defined_type(tok))
                 return 1;
             else
                 return 0;
@@ -13,6 +13,11 @@ BEGIN_CONFIG
     CONFIG_STR("-o", "OUTFILE", "Specify the file name to output", 0, "output.bc")
     CONFIG_LIST("-p", "FPATH", "Specify directories to search for imports", 0, ".:include")
     CONFIG_STR("-d", "DUMP_FILE", "Specify the file name to dump the AST into", 0, "ast_dump.dot")
+    CONFIG_BOOL("-m", "NO_MMAP", "Read source files into memory instead of mapping them", 0, 0)
+    CONFIG_STR("-c", "TOKEN_CACHE", "Keep the tokens of scanned files in this directory", 0, NULL)
+    CONFIG_STR("-s", "SCANNER", "Select the scanner: flex, fast, or diff to run both and compare", 0, "flex")
+    CONFIG_BOOL("-a", "FLAT_AST", "Keep the AST in flat arrays after it is parsed", 0, 0)
+    CONFIG_STR("-k", "AST_CACHE", "Keep the parsed modules in this directory", 0, NULL)
 END_CONFIG
 
 
@@ -25,18 +30,38 @@ memory_system_t* memory_system;
 
 int main(int argc, char **argv)
 {
-    ast_node_t* root;
-
     init_memory_system();
     configure(argc, argv);
 
     int verbose = GET_CONFIG_NUM("VERBOSE");
+    int flat_ast = GET_CONFIG_BOOL("FLAT_AST");
+    const char* dump_file = GET_CONFIG_STR("DUMP_FILE");
     init_errors(verbose, stdout);
 
+    // each module is finished with before the next one is parsed, so the
+    // memory that is used does not grow with the number of them
     for(char* str = iterate_config("INFILES"); str != NULL; str = iterate_config("INFILES"))
     {
-        root = parse(str);
+        ast_t* ast = parse(str);
+        if(ast == NULL)
+            continue;
+
+        if(flat_ast) {
+            flat_ast_t* flat = flatten_ast(ast);
+            DEBUG("flat AST of %u nodes in %zu bytes", flat->count, flat_ast_size(flat));
+            destroy_ast(ast);
+            if(verbose > 5 && dump_file)
+                dump_flat_ast(flat, dump_file);
+            destroy_flat_ast(flat);
+        }
+        else {
+            if(verbose > 5 && dump_file)
+                dump_ast(ast->root, dump_file);
+            destroy_ast(ast);
+        }
     }
+    flush_quarantine();
+    destroy_atoms();
 
     int errors = get_num_errors();
     if(errors != 0)
@@ -44,10 +69,6 @@ int main(int argc, char **argv)
     else
         printf("\nparse succeeded: %d errors: %d warnings\n", errors, get_num_warnings());
 
-    const char* dump_file = GET_CONFIG_STR("DUMP_FILE");
-    if(verbose > 5 && root && dump_file)
-        dump_ast(root, dump_file);
-
     destroy_memory_system();
 
     return errors;
@@ -1,15 +1,18 @@
 /**
  *
  * The abstract syntax tree is implemented as a tree that can have multiple
- * member nodes, which stored in a list. Members are children to the node and
- * they are siblings to each other.
+ * member nodes, which are kept in an array in the parent. Members are children
+ * to the node and they are siblings to each other.
  *
- * Note attributes are stored in a hash table by name.
+ * All of the nodes of a tree, their strings, and the arrays of children come
+ * from one arena that belongs to the tree, so building a node does not call
+ * malloc() and the whole tree is freed at one time.
  */
 #include <time.h>
 #include "common.h"
 
-// this exists and is used to avoid storing stupid in the AST attributes.
+// The names of the attributes, for dump_ast(). These are in the same order as
+// ast_attr_type_t, so the entry of an attribute is found by its slot.
 ast_attr_map_t ast_attr_map[] = {
     {NAME_ATTR, "NAME", STR_ATTR},
     {TYPE_NAME_ATTR, "TYPE_NAME", STR_ATTR},
@@ -20,9 +23,8 @@ ast_attr_map_t ast_attr_map[] = {
 };
 
 const ast_attr_map_t* attr_type_map(int type) {
-    for(int i = 0; ast_attr_map[i].str != NULL; i++)
-        if(ast_attr_map[i].type == type)
-            return &ast_attr_map[i];
+    if(type >= NAME_ATTR && type < NAME_ATTR + NUM_AST_ATTRS)
+        return &ast_attr_map[AST_ATTR_SLOT(type)];
 
     fatal_error("cannot find ast_attr_map by type = %d", type); // does not return
     return NULL; // make the compiler happy.
@@ -39,117 +41,107 @@ const ast_attr_map_t* attr_name_map(const char* name) {
 
 
 /*
- *  Create a node and return it. Memory must be free'd by destroy_node.
+ * Create an empty tree. The root node is made by the parser.
  */
-ast_node_t* create_node(int type) {
-
-    ast_node_t* node = MALLOC(sizeof(ast_node_t));
-    if(node == NULL)
-        fatal_error("cannot allocate %lu bytes for AST node", sizeof(ast_node_t));
+ast_t* create_ast(void) {
 
-    node->node_type = type;
-    node->attribs = create_hash_table();
-    node->members = create_data_list(sizeof(ast_node_t));
-    return node;
+    ast_t* ast = CALLOC(1, sizeof(ast_t));
+    ast->arena = create_arena(1024*64);
+    return ast;
 }
 
 /*
- * Destroy the underlying data structures. Note that this also frees the data structures
- * that the node contains.
+ * Free the tree and everything in it at one time, with the source files that
+ * it was parsed from. No node, string, or location from the tree can be used
+ * after this. When built with _ARENA_QUARANTINE, using one is caught, see
+ * retire_arena().
  */
-void destroy_node(ast_node_t* node) {
+void destroy_ast(ast_t* ast) {
 
-    destroy_hash_table(node->attribs);
-    destroy_data_list(node->members);
+    if(ast != NULL) {
+        destroy_exports(ast);
+        release_source_files(ast);
+        retire_arena(ast->arena);
+        FREE(ast);
+    }
 }
 
-
 /*
- * Recursively destroy the entire tree.
+ *  Create a node and return it. It belongs to the tree and is freed with it.
  */
-void destroy_ast(ast_node_t* root) {
-    // TBD
+ast_node_t* create_node(ast_t* ast, int type) {
+
+    ast_node_t* node = arena_alloc(ast->arena, sizeof(ast_node_t));
+
+    memset(node, 0, sizeof(ast_node_t));
+    node->node_type = type;
+    node->loc = NO_SOURCE_LOC;
+    ast->num_nodes++;
+    return node;
 }
 
 /*
- * Add a generic attribute. This function copies the data into an allocated memory
- * area. Care is required to prevent memory leaks when the stored data has allocated
- * pointers in it.
+ * Copy a string into the tree, such as the text of a token, which is not
+ * terminated. The copy is terminated.
  */
-int add_node_attrib(ast_node_t* node, int type, void* data, size_t size) {
-
-    const char* name = attr_type_map(type)->str;
-    int hv = insert_hash_table(node->attribs, name, data, size);
-
-    switch(hv) {
-        case HASH_NO_ERROR:
-        case HASH_EXIST:
-        case HASH_DATA_SIZE:
-            return AST_NO_ERROR;
-        case HASH_NOT_FOUND:
-        case HASH_NO_DATA:
-            return AST_ATTR_NOT_FOUND;
-    }
+const char* ast_strndup(ast_t* ast, const char* str, size_t len) {
 
-    return AST_ATTR_NOT_FOUND;
+    return arena_strndup(ast->arena, str, len);
 }
 
 /*
- * Retrieve an arbitrary data item from the hash table. The caller needs to know
- * what kind of data it is asking for. The data is copied out of the allocated
- * buffer in the hash table.
+ * Add a node to the end of the children of the parent. The array of children
+ * doubles when it is full, and it grows where it is when nothing else has been
+ * allocated since.
  */
-int get_node_attrib(ast_node_t* node, int type, void* data, size_t size) {
-
-    const char* name = attr_type_map(type)->str;
-    int hv = find_hash_table(node->attribs, name, data, size);
-
-    switch(hv) {
-        case HASH_NO_ERROR:
-        case HASH_EXIST:
-        case HASH_DATA_SIZE:
-            return AST_NO_ERROR;
-        case HASH_NOT_FOUND:
-        case HASH_NO_DATA:
-            return AST_ATTR_NOT_FOUND;
+void add_ast_node(ast_t* ast, ast_node_t* parent, ast_node_t* node) {
+
+    if(parent->num_children == parent->max_children) {
+        uint32_t max = parent->max_children? parent->max_children * 2: 4;
+        parent->children = arena_grow(ast->arena, parent->children,
+                    parent->max_children * sizeof(ast_node_t*), max * sizeof(ast_node_t*));
+        parent->max_children = max;
     }
 
-    return AST_ATTR_NOT_FOUND;
+    parent->children[parent->num_children++] = node;
 }
 
 /*
- * Get the size of the attribute data.
+ * Attributes are kept in the slot of their type, so there is nothing to look
+ * up. An attribute that a node does not have reads as NULL or 0.
  */
-size_t get_node_attr_size(ast_node_t* node, int type) {
+void set_node_str(ast_node_t* node, int type, const char* str) {
 
-    const char* name = attr_type_map(type)->str;
-    return find_hash_table_entry_size(node->attribs, name);
+    node->attrs[AST_ATTR_SLOT(type)].str = str;
+    node->attr_mask |= 1 << AST_ATTR_SLOT(type);
 }
 
-/*
- * Add a node link to the child list. This is typically done when the node has finished
- * parsing.
- */
-void add_ast_node(ast_node_t* crnt, ast_node_t* node) {
+void set_node_num(ast_node_t* node, int type, int num) {
 
-    append_data_list(crnt->members, node);
+    node->attrs[AST_ATTR_SLOT(type)].num = num;
+    node->attr_mask |= 1 << AST_ATTR_SLOT(type);
 }
 
-/*
- * Reset the internal list index to zero.
- */
-void reset_member_list(ast_node_t* node) {
+const char* get_node_str(ast_node_t* node, int type) {
 
-    reset_data_list(node->members);
+    return HAS_NODE_ATTR(node, type)? node->attrs[AST_ATTR_SLOT(type)].str: NULL;
+}
+
+int get_node_num(ast_node_t* node, int type) {
+
+    return HAS_NODE_ATTR(node, type)? node->attrs[AST_ATTR_SLOT(type)].num: 0;
 }
 
 /*
- * Get the next child and increment the internal list pointer.
+ * The name that a node is known by in the scope of its parent. An import is
+ * known by the name of the module.
  */
-ast_node_t* next_member(ast_node_t* node) {
+const char* get_node_name(ast_node_t* node) {
 
-    return (ast_node_t*)get_data_list_next(node->members);
+    return get_node_str(node, (node->node_type == IMPORT_NODE)? IMPORT_NAME_ATTR: NAME_ATTR);
 }
 
+int get_node_type(ast_node_t* node) {
 
-
+    return node->node_type;
+}
@@ -0,0 +1,137 @@
+/*
+ * Walking the AST without recursion.
+ *
+ * A cursor holds the path from the root to the node it is on, with the next
+ * child to go to at each level. Nothing is kept in the tree, so a walk does
+ * not disturb any other walk of the same tree, and the depth of a tree is only
+ * limited by memory.
+ */
+#include "common.h"
+
+void init_ast_cursor(ast_cursor_t* cur, ast_node_t* root) {
+
+    memset(cur, 0, sizeof(ast_cursor_t));
+    cur->root = root;
+}
+
+void free_ast_cursor(ast_cursor_t* cur) {
+
+    if(cur->stack != NULL)
+        FREE(cur->stack);
+    memset(cur, 0, sizeof(ast_cursor_t));
+}
+
+static void push_frame(ast_cursor_t* cur, ast_node_t* node) {
+
+    if(cur->depth >= cur->max_depth) {
+        cur->max_depth = cur->max_depth? cur->max_depth * 2: 32;
+        cur->stack = REALLOC(cur->stack, cur->max_depth * sizeof(ast_walk_frame_t));
+    }
+    cur->stack[cur->depth].node = node;
+    cur->stack[cur->depth].next_child = 0;
+    cur->depth++;
+}
+
+/*
+ * Take one step. The node that is entered or left is stored in node. Returns
+ * AST_WALK_END when the root has been left.
+ */
+ast_walk_event_t next_ast_event(ast_cursor_t* cur, ast_node_t** node) {
+
+    if(!cur->started) {
+        cur->started = 1;
+        if(cur->root == NULL)
+            return AST_WALK_END;
+        push_frame(cur, cur->root);
+        *node = cur->root;
+        return AST_WALK_ENTER;
+    }
+
+    if(cur->leaving) {
+        cur->leaving = 0;
+        cur->depth--;
+    }
+    if(cur->depth == 0)
+        return AST_WALK_END;
+
+    ast_walk_frame_t* top = &cur->stack[cur->depth - 1];
+    if(top->next_child < top->node->num_children) {
+        ast_node_t* child = top->node->children[top->next_child++];
+        push_frame(cur, child);
+        *node = child;
+        return AST_WALK_ENTER;
+    }
+
+    // stays on the stack so the parent can still be asked for
+    cur->leaving = 1;
+    *node = top->node;
+    return AST_WALK_LEAVE;
+}
+
+/*
+ * The next node in pre-order, or NULL at the end.
+ */
+ast_node_t* next_ast_node(ast_cursor_t* cur) {
+
+    ast_node_t* node;
+    ast_walk_event_t event;
+
+    while((event = next_ast_event(cur, &node)) == AST_WALK_LEAVE)
+        ;
+    return (event == AST_WALK_END)? NULL: node;
+}
+
+/*
+ * Do not go into the children of the node that was just entered. It is left
+ * by the next step.
+ */
+void skip_ast_children(ast_cursor_t* cur) {
+
+    if(cur->depth > 0 && !cur->leaving) {
+        ast_walk_frame_t* top = &cur->stack[cur->depth - 1];
+        top->next_child = top->node->num_children;
+    }
+}
+
+/*
+ * The parent of the node that was just entered or left, or NULL for the root.
+ */
+ast_node_t* get_ast_parent(ast_cursor_t* cur) {
+
+    return (cur->depth > 1)? cur->stack[cur->depth - 2].node: NULL;
+}
+
+/*
+ * How far the node that was just entered or left is below the root.
+ */
+uint32_t get_ast_depth(ast_cursor_t* cur) {
+
+    return (cur->depth > 0)? cur->depth - 1: 0;
+}
+
+/*
+ * Call pre for each node before its children and post after them. Either one
+ * can be NULL. Returns AST_VISIT_STOP if a visitor stopped the walk, or
+ * AST_VISIT_CONTINUE if every node was visited.
+ */
+int walk_ast(ast_node_t* root, ast_visit_func_t pre, ast_visit_func_t post, void* data) {
+
+    ast_cursor_t cur;
+    ast_node_t* node;
+    ast_walk_event_t event;
+    ast_visit_result_t res = AST_VISIT_CONTINUE;
+
+    init_ast_cursor(&cur, root);
+    while(res != AST_VISIT_STOP && (event = next_ast_event(&cur, &node)) != AST_WALK_END) {
+        if(event == AST_WALK_ENTER && pre != NULL) {
+            res = pre(node, get_ast_parent(&cur), data);
+            if(res == AST_VISIT_SKIP)
+                skip_ast_children(&cur);
+        }
+        else if(event == AST_WALK_LEAVE && post != NULL)
+            res = post(node, get_ast_parent(&cur), data);
+    }
+    free_ast_cursor(&cur);
+
+    return (res == AST_VISIT_STOP)? AST_VISIT_STOP: AST_VISIT_CONTINUE;
+}
@@ -35,84 +35,125 @@ const char* node_type_to_str(int type) {
  */
 static void get_node_attributes(FILE* fp, ast_node_t* node) {
 
-    const ast_attr_map_t* map;
-    const char* key;
+    for(int slot = 0; slot < NUM_AST_ATTRS; slot++) {
+        if(!(node->attr_mask & (1 << slot)))
+            continue;
 
-    for(key = iterate_hash_table(node->attribs, 1); key != NULL; key = iterate_hash_table(node->attribs, 0)) {
-        map = attr_name_map(key);
+        const ast_attr_map_t* map = &ast_attr_map[slot];
         switch(map->stype) {
-            case NUM_ATTR: {
-                    int var;
-                    get_node_attrib(node, map->type, &var, sizeof(int));
-                    switch(map->type) {
-                        case DATA_TYPE_ATTR:
-                            fprintf(fp, " %s: %s\\n", key, tok_to_strg(var));
-                            break;
-                        default:
-                            fprintf(fp, " %s: %d\\n", key, var);
-                    }
-                }
+            case NUM_ATTR:
+                if(map->type == DATA_TYPE_ATTR)
+                    fprintf(fp, " %s: %s\\n", map->str, tok_to_strg(node->attrs[slot].num));
+                else
+                    fprintf(fp, " %s: %d\\n", map->str, node->attrs[slot].num);
                 break;
-            case STR_ATTR: {
-                    size_t size = get_node_attr_size(node, map->type);
-                    char* str = MALLOC(size);
-                    get_node_attrib(node, map->type, (void*)str, size);
-                    fprintf(fp, " %s: %s\\n", key, str);
-                    FREE((void*)str);
-                }
+            case STR_ATTR:
+                fprintf(fp, " %s: %s\\n", map->str, node->attrs[slot].str);
                 break;
-            case STRUCT_ATTR: {
-                    fprintf(fp, " %s: <struct>\\n", key);
-                }
+            case STRUCT_ATTR:
+                fprintf(fp, " %s: <struct>\\n", map->str);
                 break;
             default:
-                fprintf(fp, " %s: <unknown stype>\\n", key);
+                fprintf(fp, " %s: <unknown stype>\\n", map->str);
         }
     }
 }
 
-static void dump_walk_ast(FILE* fp, ast_node_t* node, const char* prev_name) {
+static void put_node(FILE* fp, const char* name, const char* prev_name, ast_node_t* node) {
 
-    char name[30];
-    ast_node_t* n;
-
-    sprintf(name, "node_%p", node);
     fprintf(fp, "    %s [label=\"{type: %s\\nattributes: \\n", name, node_type_to_str(node->node_type));
     get_node_attributes(fp, node);
     fprintf(fp, "}\"];\n");
     if(prev_name != NULL)
         fprintf(fp, "    %s -> %s;\n", prev_name, name);
+}
 
-    fflush(fp);
-
-    while(NULL != (n = next_member(node)))
-        dump_walk_ast(fp, n, name);
+static void dump_walk_ast(FILE* fp, ast_node_t* root) {
 
+    char name[30];
+    char prev_name[30];
+    ast_cursor_t cur;
+    ast_node_t* node;
+
+    init_ast_cursor(&cur, root);
+    while((node = next_ast_node(&cur)) != NULL) {
+        ast_node_t* parent = get_ast_parent(&cur);
+        sprintf(name, "node_%p", (void*)node);
+        sprintf(prev_name, "node_%p", (void*)parent);
+        put_node(fp, name, parent? prev_name: NULL, node);
+    }
+    free_ast_cursor(&cur);
 }
 
-/*
- * Dump the specified AST as a ".dot" file to the file name specified.
- * https://www.graphviz.org/doc/info/lang.html
- */
-void dump_ast(ast_node_t* root, const char* file) {
+static FILE* open_dump(const char* file) {
 
     time_t t = time(NULL);
     FILE* outfile = fopen(file, "w");
 
     if(outfile == NULL) {
         fprintf(stderr, "Graph Error: Cannot open %s for writing: %s\n", file, strerror(errno));
-        return;
+        return NULL;
     }
 
-    fprintf(outfile, "// file name \"%s\" dumped %s", get_file_name(), ctime(&t));
+    fprintf(outfile, "// file name \"%s\" dumped %s", file, ctime(&t));
     fprintf(outfile, "digraph Source_AST_Tree {\n");
-    fprintf(outfile, "    label=\"file name %s dumped %s\"", get_file_name(), ctime(&t));
+    fprintf(outfile, "    label=\"file name %s dumped %s\"", file, ctime(&t));
     fprintf(outfile, "    node [style=\"rounded,filled\" shape=record]\n\n");
 
-    dump_walk_ast(outfile, root, NULL); // root only has children
+    return outfile;
+}
 
-    fprintf(outfile, "\n}\n");
+static void close_dump(FILE* outfile) {
 
+    fprintf(outfile, "\n}\n");
     fclose(outfile);
 }
 
+/*
+ * Dump the specified AST as a ".dot" file to the file name specified.
+ * https://www.graphviz.org/doc/info/lang.html
+ */
+void dump_ast(ast_node_t* root, const char* file) {
+
+    FILE* outfile = open_dump(file);
+
+    if(outfile != NULL) {
+        dump_walk_ast(outfile, root);
+        close_dump(outfile);
+    }
+}
+
+/*
+ * The same for a flat AST. The nodes are in pre-order, so they come out in the
+ * same order as they do from the tree, and the parent of each one is found on
+ * the way.
+ */
+void dump_flat_ast(flat_ast_t* flat, const char* file) {
+
+    FILE* outfile = open_dump(file);
+    char name[30];
+    char prev_name[30];
+
+    if(outfile == NULL)
+        return;
+
+    ast_index_t* parent = MALLOC(flat->count * sizeof(ast_index_t));
+    for(ast_index_t i = 0; i < flat->count; i++)
+        for(ast_index_t c = flat->first_child[i]; c != NO_AST_INDEX; c = flat->next_sibling[c])
+            parent[c] = i;
+
+    // each node is put back into a node struct to show it
+    for(ast_index_t i = 0; i < flat->count; i++) {
+        ast_node_t node;
+        memset(&node, 0, sizeof(node));
+        expand_flat_node(flat, i, &node, NULL);
+
+        sprintf(name, "node_%u", i);
+        sprintf(prev_name, "node_%u", parent[i]);
+        put_node(outfile, name, i? prev_name: NULL, &node);
+    }
+
+    FREE(parent);
+    close_dump(outfile);
+}
+
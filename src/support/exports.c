@@ -0,0 +1,79 @@
+/*
+ * Export tables.
+ *
+ * When an imported module is finished, the names that it defines go in a
+ * table of their own, which is kept in the tree under the name of the module.
+ * A reference like module.name is then found by looking up the module and
+ * then the name, each of them one probe with an atom, and the children of the
+ * import are never searched.
+ *
+ * The same module can be imported in more than one place. The tree has the
+ * same definitions under each of those imports, so the table of the first one
+ * is the one that is kept.
+ */
+#include "common.h"
+
+/*
+ * Make the export table of an import node, once its module has been read.
+ * A module that imports another one exports that import under the name of
+ * the module, so a name can be followed through more than one module.
+ */
+void add_exports(ast_t* ast, ast_node_t* import) {
+
+    atom_t module = get_node_str(import, IMPORT_NAME_ATTR);
+
+    if(module == NULL || get_exports(ast, module) != NULL)
+        return;
+
+    if(ast->exports == NULL)
+        ast->exports = create_atom_hash_table();
+
+    hash_table_t* table = create_atom_hash_table();
+    for(uint32_t i = 0; i < import->num_children; i++) {
+        ast_node_t* node = import->children[i];
+        atom_t name = get_node_name(node);
+        // the first definition of a name is the one that is used
+        if(name != NULL)
+            insert_hash_table(table, name, &node, sizeof(node));
+    }
+    insert_hash_table(ast->exports, module, &table, sizeof(table));
+}
+
+/*
+ * The export table of a module, which maps the name of each definition to its
+ * node, or NULL if no module of that name was imported.
+ */
+hash_table_t* get_exports(ast_t* ast, atom_t module) {
+
+    hash_table_t* table = NULL;
+
+    if(ast->exports != NULL && module != NULL)
+        find_hash_table(ast->exports, module, &table, sizeof(table));
+    return table;
+}
+
+/*
+ * The node that a module defines for the name, or NULL.
+ */
+ast_node_t* find_export(ast_t* ast, atom_t module, atom_t name) {
+
+    hash_table_t* table = get_exports(ast, module);
+    ast_node_t* node = NULL;
+
+    if(table != NULL)
+        find_hash_table(table, name, &node, sizeof(node));
+    return node;
+}
+
+void destroy_exports(ast_t* ast) {
+
+    hash_cursor_t cur;
+
+    if(ast->exports != NULL) {
+        init_hash_cursor(&cur);
+        while(next_hash_entry(ast->exports, &cur))
+            destroy_hash_table(*(hash_table_t**)cur.data);
+        destroy_hash_table(ast->exports);
+        ast->exports = NULL;
+    }
+}
@@ -0,0 +1,493 @@
+/*
+ * The AST in flat arrays.
+ *
+ * A tree that the parser built is copied into arrays that hold one field of
+ * every node each, with the nodes in pre-order. Children and siblings are
+ * 32 bit indexes instead of pointers, and the fields that only some nodes
+ * have are kept in a separate payload array. This takes about half of the
+ * memory of the tree, and a pass that looks at every node goes through the
+ * arrays in order.
+ *
+ * The arrays can be saved to a file and mapped back in as they are. Nothing in
+ * them is a pointer, so there is nothing to fix up when they are loaded. A
+ * module that is saved this way can be put back into a tree without being
+ * parsed again.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common.h"
+
+#define FLAT_AST_MAGIC "SIMPAST"
+
+/*
+ * A saved tree is this header and then the arrays, each one starting on an
+ * 8 byte boundary. Where each array starts is kept as an offset from the start
+ * of the file.
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t num_payloads;
+    uint32_t strings_len;
+    uint64_t hash;          // of the source that the tree was parsed from
+    uint64_t size;          // of the source
+    uint64_t kind;
+    uint64_t first_child;
+    uint64_t next_sibling;
+    uint64_t loc;
+    uint64_t payload;
+    uint64_t payloads;
+    uint64_t strings;
+} flat_ast_header_t;
+
+typedef struct {
+    flat_ast_t* flat;
+    uint32_t max_payloads;
+    uint32_t max_strings;
+    source_loc_t loc_base;  // subtracted from every location
+    int skip_imports;       // leave out the modules that are imported
+} flattener_t;
+
+static void* grow_array(void* ptr, uint32_t* max, uint32_t need, size_t size) {
+
+    if(need > *max) {
+        while(need > *max)
+            *max = *max? *max * 2: 64;
+        ptr = REALLOC(ptr, *max * size);
+    }
+    return ptr;
+}
+
+static uint32_t add_string(flattener_t* fl, const char* str) {
+
+    flat_ast_t* flat = fl->flat;
+
+    if(str == NULL)
+        return 0;
+
+    uint32_t len = strlen(str) + 1;
+    uint32_t offset = flat->strings_len;
+    flat->strings = grow_array(flat->strings, &fl->max_strings, offset + len, 1);
+    memcpy(&flat->strings[offset], str, len);
+    flat->strings_len += len;
+    return offset;
+}
+
+static uint32_t add_payload(flattener_t* fl, ast_node_t* node) {
+
+    flat_ast_t* flat = fl->flat;
+
+    if(node->attr_mask == 0)
+        return 0;
+
+    flat->payloads = grow_array(flat->payloads, &fl->max_payloads,
+                        flat->num_payloads + 1, sizeof(flat_payload_t));
+    flat_payload_t* pl = &flat->payloads[flat->num_payloads];
+    // only an import has an import name, and it has no other name
+    pl->name = add_string(fl, (node->node_type == IMPORT_NODE)?
+                    get_node_str(node, IMPORT_NAME_ATTR): get_node_str(node, NAME_ATTR));
+    pl->type_name = add_string(fl, get_node_str(node, TYPE_NAME_ATTR));
+    pl->data_type = get_node_num(node, DATA_TYPE_ATTR);
+    pl->ptr_depth = get_node_num(node, IS_POINTER_ATTR);
+    return flat->num_payloads++;
+}
+
+/*
+ * Copy the nodes in the order that a walk enters them, which is pre-order.
+ * For each level of the walk, the node there and the last child that was
+ * copied under it are kept, so each node is linked to its parent or its
+ * sibling as it is copied.
+ */
+static void flatten_nodes(flattener_t* fl, ast_node_t* root) {
+
+    flat_ast_t* flat = fl->flat;
+    ast_cursor_t cur;
+    ast_node_t* node;
+    uint32_t max_levels = 0;
+    ast_index_t* levels = NULL;   // the node and its last child, for each level
+
+    init_ast_cursor(&cur, root);
+    while((node = next_ast_node(&cur)) != NULL) {
+        uint32_t depth = get_ast_depth(&cur);
+        ast_index_t idx = flat->count++;
+
+        flat->kind[idx] = node->node_type;
+        flat->loc[idx] = (node->loc == NO_SOURCE_LOC)? NO_SOURCE_LOC: node->loc - fl->loc_base;
+        flat->payload[idx] = add_payload(fl, node);
+        flat->first_child[idx] = NO_AST_INDEX;
+        flat->next_sibling[idx] = NO_AST_INDEX;
+
+        levels = grow_array(levels, &max_levels, (depth + 1) * 2, sizeof(ast_index_t));
+        if(depth > 0) {
+            ast_index_t* up = &levels[(depth - 1) * 2];
+            if(up[1] == NO_AST_INDEX)
+                flat->first_child[up[0]] = idx;
+            else
+                flat->next_sibling[up[1]] = idx;
+            up[1] = idx;
+        }
+        levels[depth * 2] = idx;
+        levels[depth * 2 + 1] = NO_AST_INDEX;
+
+        // the top node of a module can be the import that it was parsed into
+        if(fl->skip_imports && depth > 0 && node->node_type == IMPORT_NODE)
+            skip_ast_children(&cur);
+    }
+
+    free_ast_cursor(&cur);
+    FREE(levels);
+}
+
+/*
+ * The node and everything under it, except what is under the imports below it.
+ */
+static uint32_t count_module(ast_node_t* node) {
+
+    ast_cursor_t cur;
+    uint32_t count = 0;
+
+    init_ast_cursor(&cur, node);
+    while((node = next_ast_node(&cur)) != NULL) {
+        count++;
+        if(get_ast_depth(&cur) > 0 && node->node_type == IMPORT_NODE)
+            skip_ast_children(&cur);
+    }
+    free_ast_cursor(&cur);
+
+    return count;
+}
+
+static flat_ast_t* flatten_tree(ast_node_t* root, size_t max, source_loc_t loc_base, int skip_imports) {
+
+    flattener_t fl;
+
+    if(root == NULL || max == 0 || max > UINT32_MAX)
+        fatal_error("cannot flatten a tree of %zu nodes", max);
+
+    flat_ast_t* flat = CALLOC(1, sizeof(flat_ast_t));
+    flat->kind = MALLOC(max * sizeof(uint8_t));
+    flat->first_child = MALLOC(max * sizeof(ast_index_t));
+    flat->next_sibling = MALLOC(max * sizeof(ast_index_t));
+    flat->loc = MALLOC(max * sizeof(source_loc_t));
+    flat->payload = MALLOC(max * sizeof(uint32_t));
+
+    fl.flat = flat;
+    fl.max_payloads = 0;
+    fl.max_strings = 0;
+    fl.loc_base = loc_base;
+    fl.skip_imports = skip_imports;
+
+    // the empty ones that are shared
+    flat->payloads = grow_array(NULL, &fl.max_payloads, 1, sizeof(flat_payload_t));
+    memset(&flat->payloads[0], 0, sizeof(flat_payload_t));
+    flat->num_payloads = 1;
+    flat->strings = grow_array(NULL, &fl.max_strings, 1, 1);
+    flat->strings[0] = '\0';
+    flat->strings_len = 1;
+
+    flatten_nodes(&fl, root);
+
+    return flat;
+}
+
+/*
+ * Copy a tree into flat arrays. The tree is not changed and can be destroyed
+ * after this.
+ */
+flat_ast_t* flatten_ast(ast_t* ast) {
+
+    return flatten_tree(ast->root, ast->num_nodes, 0, 0);
+}
+
+/*
+ * Copy one module: the node that it was parsed into and everything under it,
+ * except what is under its imports, which are modules of their own. The
+ * locations are made relative to base, the location of the first character of
+ * the module, so that they still mean something when the module is put back
+ * in another run.
+ */
+flat_ast_t* flatten_module(ast_node_t* node, source_loc_t base) {
+
+    // one less than the base, so that the first character is not NO_SOURCE_LOC
+    return flatten_tree(node, count_module(node), base - 1, 1);
+}
+
+void destroy_flat_ast(flat_ast_t* flat) {
+
+    if(flat != NULL && flat->map != NULL) {
+        // the arrays are in the mapping
+        munmap(flat->map, flat->map_len);
+        FREE(flat);
+    }
+    else if(flat != NULL) {
+        FREE(flat->kind);
+        FREE(flat->first_child);
+        FREE(flat->next_sibling);
+        FREE(flat->loc);
+        FREE(flat->payload);
+        FREE(flat->payloads);
+        FREE(flat->strings);
+        FREE(flat);
+    }
+}
+
+/*
+ * The number of bytes that the nodes, payloads, and strings take.
+ */
+size_t flat_ast_size(flat_ast_t* flat) {
+
+    size_t per_node = sizeof(uint8_t) + 2 * sizeof(ast_index_t) + sizeof(source_loc_t) + sizeof(uint32_t);
+    return flat->count * per_node + flat->num_payloads * sizeof(flat_payload_t) + flat->strings_len;
+}
+
+const char* flat_node_name(flat_ast_t* flat, ast_index_t node) {
+
+    uint32_t offset = flat->payloads[flat->payload[node]].name;
+    return offset? &flat->strings[offset]: NULL;
+}
+
+const char* flat_node_type_name(flat_ast_t* flat, ast_index_t node) {
+
+    uint32_t offset = flat->payloads[flat->payload[node]].type_name;
+    return offset? &flat->strings[offset]: NULL;
+}
+
+int flat_node_data_type(flat_ast_t* flat, ast_index_t node) {
+
+    return flat->payloads[flat->payload[node]].data_type;
+}
+
+int flat_node_ptr_depth(flat_ast_t* flat, ast_index_t node) {
+
+    return flat->payloads[flat->payload[node]].ptr_depth;
+}
+
+/*
+ * Fill in a node from a flat one. The names are made atoms, the same as the
+ * parser makes them, or point into the flat arrays if the tree is NULL. The
+ * location is left as it is in the arrays.
+ */
+void expand_flat_node(flat_ast_t* flat, ast_index_t idx, ast_node_t* node, ast_t* ast) {
+
+    const char* str;
+
+    node->node_type = flat->kind[idx];
+    node->loc = flat->loc[idx];
+
+    if((str = flat_node_name(flat, idx)) != NULL)
+        set_node_str(node, (node->node_type == IMPORT_NODE)? IMPORT_NAME_ATTR: NAME_ATTR,
+                    ast? intern_string(str): str);
+    if((str = flat_node_type_name(flat, idx)) != NULL)
+        set_node_str(node, TYPE_NAME_ATTR, ast? intern_string(str): str);
+    if(flat_node_data_type(flat, idx) != 0)
+        set_node_num(node, DATA_TYPE_ATTR, flat_node_data_type(flat, idx));
+    if(flat_node_ptr_depth(flat, idx) != 0)
+        set_node_num(node, IS_POINTER_ATTR, flat_node_ptr_depth(flat, idx));
+}
+
+/*
+ * Put a module that was copied with flatten_module() back into a tree. The
+ * children of its top node are added to parent, and the locations are made
+ * relative to base again. A parent comes before its children in the arrays,
+ * and siblings come in their order, so one pass in order makes the tree.
+ */
+void graft_flat_ast(ast_t* ast, ast_node_t* parent, flat_ast_t* flat, source_loc_t base) {
+
+    ast_index_t* up = CALLOC(flat->count, sizeof(ast_index_t));
+    ast_node_t** made = MALLOC(flat->count * sizeof(ast_node_t*));
+
+    for(ast_index_t i = 0; i < flat->count; i++)
+        for(ast_index_t c = flat->first_child[i]; c != NO_AST_INDEX; c = flat->next_sibling[c])
+            up[c] = i;
+
+    made[0] = parent;
+    for(ast_index_t i = 1; i < flat->count; i++) {
+        ast_node_t* node = create_node(ast, flat->kind[i]);
+        expand_flat_node(flat, i, node, ast);
+        if(node->loc != NO_SOURCE_LOC)
+            node->loc += base - 1;
+        add_ast_node(ast, made[up[i]], node);
+        made[i] = node;
+    }
+
+    FREE(up);
+    FREE(made);
+}
+
+static uint64_t align_offset(uint64_t offset) {
+
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+/*
+ * Work out where each array goes in the file. Returns the size of the file.
+ */
+static uint64_t layout(flat_ast_header_t* head) {
+
+    uint64_t offset = sizeof(flat_ast_header_t);
+
+    head->kind = offset;
+    offset = align_offset(offset + head->count * sizeof(uint8_t));
+    head->first_child = offset;
+    offset = align_offset(offset + head->count * sizeof(ast_index_t));
+    head->next_sibling = offset;
+    offset = align_offset(offset + head->count * sizeof(ast_index_t));
+    head->loc = offset;
+    offset = align_offset(offset + head->count * sizeof(source_loc_t));
+    head->payload = offset;
+    offset = align_offset(offset + head->count * sizeof(uint32_t));
+    head->payloads = offset;
+    offset = align_offset(offset + head->num_payloads * sizeof(flat_payload_t));
+    head->strings = offset;
+    return offset + head->strings_len;
+}
+
+static int write_array(FILE* fp, uint64_t offset, const void* ptr, size_t size) {
+
+    static const char zeros[8];
+    long pad = (long)offset - ftell(fp);
+
+    if(pad < 0 || pad > 8 || fwrite(zeros, 1, pad, fp) != (size_t)pad)
+        return 0;
+    return size == 0 || fwrite(ptr, size, 1, fp) == 1;
+}
+
+/*
+ * Save the arrays with the hash and size of the source that they came from.
+ * The file is written under a temporary name and renamed, so a run that maps
+ * it at the same time never sees half of it. Returns 0 on success, or -1 and
+ * a warning if it could not be written.
+ */
+int save_flat_ast(flat_ast_t* flat, const char* fname, uint64_t hash, uint64_t size) {
+
+    flat_ast_header_t head;
+    char tmp[1100];
+
+    memset(&head, 0, sizeof(head));
+    memcpy(head.magic, FLAT_AST_MAGIC, sizeof(FLAT_AST_MAGIC));
+    head.version = FLAT_AST_VERSION;
+    head.count = flat->count;
+    head.num_payloads = flat->num_payloads;
+    head.strings_len = flat->strings_len;
+    head.hash = hash;
+    head.size = size;
+    layout(&head);
+
+    snprintf(tmp, sizeof(tmp), "%s.%d", fname, (int)getpid());
+    FILE* fp = fopen(tmp, "wb");
+    if(fp == NULL) {
+        warning("cannot write the AST file \"%s\": %s", tmp, strerror(errno));
+        return -1;
+    }
+
+    int ok = fwrite(&head, sizeof(head), 1, fp) == 1 &&
+        write_array(fp, head.kind, flat->kind, flat->count * sizeof(uint8_t)) &&
+        write_array(fp, head.first_child, flat->first_child, flat->count * sizeof(ast_index_t)) &&
+        write_array(fp, head.next_sibling, flat->next_sibling, flat->count * sizeof(ast_index_t)) &&
+        write_array(fp, head.loc, flat->loc, flat->count * sizeof(source_loc_t)) &&
+        write_array(fp, head.payload, flat->payload, flat->count * sizeof(uint32_t)) &&
+        write_array(fp, head.payloads, flat->payloads, flat->num_payloads * sizeof(flat_payload_t)) &&
+        write_array(fp, head.strings, flat->strings, flat->strings_len);
+
+    if(fclose(fp) != 0 || !ok || rename(tmp, fname) != 0) {
+        warning("cannot write the AST file \"%s\": %s", fname, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * A file that is mapped is trusted no further than this. Every index has to
+ * be inside its array, so that a damaged file cannot make a walk of the
+ * arrays go outside of them.
+ */
+static int check_arrays(flat_ast_t* flat) {
+
+    if(flat->count == 0 || flat->num_payloads == 0 || flat->strings_len == 0 ||
+            flat->strings[flat->strings_len - 1] != '\0')
+        return 0;
+
+    for(uint32_t i = 0; i < flat->count; i++) {
+        if(flat->kind[i] <= NO_NODE_TYPE || flat->kind[i] >= NUM_AST_NODE_TYPES ||
+                flat->first_child[i] >= flat->count ||
+                flat->next_sibling[i] >= flat->count ||
+                flat->payload[i] >= flat->num_payloads)
+            return 0;
+        // pre-order, so the links only go forward and cannot loop
+        if((flat->first_child[i] != NO_AST_INDEX && flat->first_child[i] <= i) ||
+                (flat->next_sibling[i] != NO_AST_INDEX && flat->next_sibling[i] <= i))
+            return 0;
+    }
+
+    for(uint32_t i = 0; i < flat->num_payloads; i++)
+        if(flat->payloads[i].name >= flat->strings_len ||
+                flat->payloads[i].type_name >= flat->strings_len)
+            return 0;
+
+    return 1;
+}
+
+/*
+ * Map a file that was written by save_flat_ast(). The arrays are used where
+ * they are in the mapping. Returns NULL if the file is not there, or if it was
+ * not saved from a source with this hash and size, or by this version.
+ */
+flat_ast_t* map_flat_ast(const char* fname, uint64_t hash, uint64_t size) {
+
+    struct stat st;
+    flat_ast_header_t head;
+
+    int fd = open(fname, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+
+    if(fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(flat_ast_header_t)) {
+        close(fd);
+        return NULL;
+    }
+
+    char* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return NULL;
+
+    // the offsets in the file have to be the ones that this build would use
+    memcpy(&head, map, sizeof(head));
+    flat_ast_header_t want = head;
+    if(memcmp(head.magic, FLAT_AST_MAGIC, sizeof(FLAT_AST_MAGIC)) ||
+            head.version != FLAT_AST_VERSION ||
+            head.hash != hash ||
+            head.size != size ||
+            layout(&want) != (uint64_t)st.st_size ||
+            memcmp(&want, &head, sizeof(head))) {
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    flat_ast_t* flat = CALLOC(1, sizeof(flat_ast_t));
+    flat->kind = (uint8_t*)(map + head.kind);
+    flat->first_child = (ast_index_t*)(map + head.first_child);
+    flat->next_sibling = (ast_index_t*)(map + head.next_sibling);
+    flat->loc = (source_loc_t*)(map + head.loc);
+    flat->payload = (uint32_t*)(map + head.payload);
+    flat->count = head.count;
+    flat->payloads = (flat_payload_t*)(map + head.payloads);
+    flat->num_payloads = head.num_payloads;
+    flat->strings = map + head.strings;
+    flat->strings_len = head.strings_len;
+    flat->map = map;
+    flat->map_len = st.st_size;
+
+    if(!check_arrays(flat)) {
+        warning("the AST file \"%s\" is damaged and is not used", fname);
+        destroy_flat_ast(flat);
+        return NULL;
+    }
+
+    return flat;
+}
@@ -0,0 +1,110 @@
+/*
+ * Scoped symbol table.
+ *
+ * Every name has one entry in the hash table, the binding that is seen from
+ * the innermost scope. When a name is added, the binding that it replaces, if
+ * any, goes in the undo log. Pushing a scope remembers how long the log is,
+ * and popping it takes the log back to that length, putting back each binding
+ * that the scope replaced. A scope costs only the names that were added in it,
+ * and nothing is copied when one is pushed.
+ *
+ * The names are atoms. The table keeps pointers to the nodes, which have to
+ * stay where they are for as long as the table is used.
+ */
+#include "common.h"
+
+typedef struct {
+    atom_t name;
+    scope_binding_t old;    // old.node is NULL if the name was not bound
+} scope_undo_t;
+
+scope_table_t* create_scope_table(void) {
+
+    scope_table_t* table = MALLOC(sizeof(scope_table_t));
+
+    table->names = create_atom_hash_table();
+    watch_hash_table(table->names, NULL);
+    table->undo = create_data_list(sizeof(scope_undo_t));
+    table->marks = create_data_list(sizeof(size_t));
+    table->depth = 0;
+    return table;
+}
+
+void destroy_scope_table(scope_table_t* table) {
+
+    if(table != NULL) {
+        unwatch_hash_table(table->names);
+        destroy_hash_table(table->names);
+        destroy_data_list(table->undo);
+        destroy_data_list(table->marks);
+        FREE(table);
+    }
+}
+
+void push_scope(scope_table_t* table) {
+
+    append_data_list(table->marks, &table->undo->nitems);
+    table->depth++;
+}
+
+/*
+ * Take away the names that were added in the innermost scope, and put back
+ * the ones that they hid, newest first.
+ */
+void pop_scope(scope_table_t* table) {
+
+    if(table->depth == 0)
+        fatal_error("there is no scope to pop");
+
+    size_t mark = *(size_t*)get_data_list_by_index(table->marks, table->marks->nitems - 1);
+
+    for(size_t i = table->undo->nitems; i > mark; i--) {
+        scope_undo_t* undo = get_data_list_by_index(table->undo, i - 1);
+        if(undo->old.node == NULL)
+            remove_hash_table(table->names, undo->name);
+        else
+            *(scope_binding_t*)find_hash_table_data(table->names, undo->name) = undo->old;
+    }
+
+    table->undo->nitems = mark;
+    table->marks->nitems--;
+    table->depth--;
+}
+
+/*
+ * Add the name to the innermost scope. A name can hide one from an outer
+ * scope, but it can be added to a scope only once.
+ */
+int add_scoped_symbol(scope_table_t* table, atom_t name, ast_node_t* node) {
+
+    scope_binding_t* binding = find_hash_table_data(table->names, name);
+    scope_binding_t bind = {node, table->depth};
+
+    if(binding != NULL && binding->depth == table->depth)
+        return ST_SYMBOL_EXISTS;
+
+    // nothing is popped past the outermost scope, so it needs no undo
+    if(table->depth > 0) {
+        scope_undo_t undo = {name, {NULL, 0}};
+        if(binding != NULL)
+            undo.old = *binding;
+        append_data_list(table->undo, &undo);
+    }
+
+    if(binding != NULL)
+        *binding = bind;
+    else
+        insert_hash_table(table->names, name, &bind, sizeof(bind));
+
+    return ST_NO_ERROR;
+}
+
+/*
+ * The node that the name is bound to in the innermost scope that has it, or
+ * NULL if no scope has it.
+ */
+ast_node_t* find_scoped_symbol(scope_table_t* table, atom_t name) {
+
+    scope_binding_t* binding = find_hash_table_data(table->names, name);
+    return (binding != NULL)? binding->node: NULL;
+}
@@ -1,4 +1,3 @@
-
 /*
  * Symbol table.
  *
@@ -7,22 +6,94 @@
  * symbol the dots are taken apart.
  *
  * The symbol table stores a pointer to the AST node that defines the symbol. Things like scope and
- * type are stored there.
+ * type are stored there. The nodes are in the arena of the tree and never move, so a look up gives
+ * back the pointer that was added, and the caller does not own it.
+ *
+ * The names are kept as atoms, so a name is found by its pointer. A name that was never made an atom
+ * cannot be in the table, so looking it up does not make one.
+ *
+ * The table is split into stripes, each a hash table with its own lock, so threads that work on
+ * names in different stripes do not wait for each other. The stripe is picked with the high bits of
+ * the hash of the name. The hash table in the stripe uses the low bits, so the names in a stripe
+ * still spread over all of its slots.
  */
+#include <pthread.h>
 
 #include "common.h"
 
+#define STRIPE_BITS 6
+#define NUM_STRIPES (1 << STRIPE_BITS)
+
+#define CACHE_LINE 64
+
+// each stripe starts a cache line of its own, so taking one lock does not slow the next one
+typedef struct {
+    _Alignas(CACHE_LINE) pthread_mutex_t lock;
+    hash_table_t* table;
+} stripe_t;
+
+struct _symbol_table_t {
+    stripe_t stripes[NUM_STRIPES];
+    ast_t* ast;     // where the export tables of the imports are, or NULL
+};
+
+static inline stripe_t* get_stripe(symbol_table_t table, atom_t name) {
+    return &table->stripes[atom_hash(name) >> (32 - STRIPE_BITS)];
+}
+
 symbol_table_t create_symbol_table(void) {
-    return (symbol_table_t)create_hash_table();
+
+    // the size is a multiple of the alignment, because the stripes are aligned
+    symbol_table_t table = aligned_alloc(CACHE_LINE, sizeof(struct _symbol_table_t));
+    if(table == NULL)
+        fatal_error("cannot allocate the symbol table");
+
+    for(int i = 0; i < NUM_STRIPES; i++) {
+        pthread_mutex_init(&table->stripes[i].lock, NULL);
+        table->stripes[i].table = create_atom_hash_table();
+        watch_hash_table(table->stripes[i].table, &table->stripes[i].lock);
+    }
+    table->ast = NULL;
+    return table;
+}
+
+/*
+ * Look up module qualified names in the export tables of the tree. The tables
+ * are not locked, so the tree must be done being parsed.
+ */
+void set_symbol_exports(symbol_table_t table, ast_t* ast) {
+
+    table->ast = ast;
 }
 
 void destroy_symbol_table(symbol_table_t table) {
-    destroy_hash_table((hash_table_t*)table);
+
+    if(table != NULL) {
+        for(int i = 0; i < NUM_STRIPES; i++) {
+            unwatch_hash_table(table->stripes[i].table);
+            pthread_mutex_destroy(&table->stripes[i].lock);
+            destroy_hash_table(table->stripes[i].table);
+        }
+        FREE(table);
+    }
 }
 
 int add_symbol(symbol_table_t table, const char* name, ast_node_t* node) {
 
-    int retv = insert_hash_table(table, name, node, sizeof(ast_node_t));
+    return add_atom_symbol(table, intern_string(name), node);
+}
+
+/*
+ * The same as add_symbol(), for a name that is already an atom, such as the
+ * name of a node. The atoms are not locked for this.
+ */
+int add_atom_symbol(symbol_table_t table, atom_t name, ast_node_t* node) {
+
+    stripe_t* stripe = get_stripe(table, name);
+
+    pthread_mutex_lock(&stripe->lock);
+    int retv = insert_hash_table(stripe->table, name, &node, sizeof(ast_node_t*));
+    pthread_mutex_unlock(&stripe->lock);
 
     switch(retv) {
         case HASH_NO_ERROR:
@@ -39,7 +110,17 @@ int add_symbol(symbol_table_t table, const char* name, ast_node_t* node) {
 
 int peek_symbol(symbol_table_t table, const char* name) {
 
-    int retv = find_hash_table(table, name, NULL, 0);
+    atom_t atom = find_atom(name, strlen(name));
+    return (atom != NULL)? peek_atom_symbol(table, atom): ST_NOT_FOUND;
+}
+
+int peek_atom_symbol(symbol_table_t table, atom_t name) {
+
+    stripe_t* stripe = get_stripe(table, name);
+
+    pthread_mutex_lock(&stripe->lock);
+    int retv = find_hash_table(stripe->table, name, NULL, 0);
+    pthread_mutex_unlock(&stripe->lock);
 
     switch(retv) {
         case HASH_NO_ERROR:
@@ -54,18 +135,94 @@ int peek_symbol(symbol_table_t table, const char* name) {
     return retv;
 }
 
+/*
+ * The node of a name that is looked up whole, dots and all.
+ */
 ast_node_t* get_symbol_reference(symbol_table_t table, const char* name) {
 
-    ast_node_t* node = MALLOC(sizeof(ast_node_t));
-    int retv = find_hash_table(table, name, node, sizeof(ast_node_t));
+    atom_t atom = find_atom(name, strlen(name));
+    return (atom != NULL)? get_atom_symbol(table, atom): NULL;
+}
 
-    switch(retv) {
-        case HASH_NO_ERROR:
-            return node;
-        default:
-            FREE(node);
+ast_node_t* get_atom_symbol(symbol_table_t table, atom_t name) {
+
+    stripe_t* stripe = get_stripe(table, name);
+    ast_node_t* node = NULL;
+
+    pthread_mutex_lock(&stripe->lock);
+    find_hash_table(stripe->table, name, &node, sizeof(node));
+    pthread_mutex_unlock(&stripe->lock);
+
+    return node;
+}
+
+/*
+ * The node of a name in dot notation, such as module.struct.member. The first
+ * part is looked up in the table, or else taken as the name of an imported
+ * module. A part after a module, or after an import node, is found in the
+ * export table of the module. Any other part is a child of the node before
+ * it. The parts are atoms like the names of the nodes, so they are compared
+ * by pointer.
+ */
+ast_node_t* get_symbol_definition(symbol_table_t table, const char* name) {
+
+    const char* dot = strchr(name, '.');
+    size_t len = (dot != NULL)? (size_t)(dot - name): strlen(name);
+    atom_t part = find_atom(name, len);
+    atom_t module = NULL;
+
+    if(part == NULL)
+        return NULL;
+
+    ast_node_t* node = get_atom_symbol(table, part);
+    if(node == NULL && dot != NULL && table->ast != NULL && get_exports(table->ast, part) != NULL)
+        module = part;
+    else if(node == NULL)
+        return NULL;
+
+    while(dot != NULL) {
+        name = dot + 1;
+        dot = strchr(name, '.');
+        len = (dot != NULL)? (size_t)(dot - name): strlen(name);
+        if((part = find_atom(name, len)) == NULL)
+            return NULL;
+
+        // an import whose module has no table yet is searched like any other node
+        if(module == NULL && node->node_type == IMPORT_NODE && table->ast != NULL &&
+                get_exports(table->ast, get_node_str(node, IMPORT_NAME_ATTR)) != NULL)
+            module = get_node_str(node, IMPORT_NAME_ATTR);
+
+        if(module != NULL) {
+            node = find_export(table->ast, module, part);
+            module = NULL;
+        }
+        else {
+            ast_node_t* parent = node;
+            node = NULL;
+            for(uint32_t i = 0; i < parent->num_children; i++)
+                if(get_node_name(parent->children[i]) == part) {
+                    node = parent->children[i];
+                    break;
+                }
+        }
+        if(node == NULL)
             return NULL;
     }
-    return node; // caller must free this
+    return node;
 }
 
+/*
+ * The number of names in the table. It is only exact when no other thread is
+ * adding to the table.
+ */
+size_t num_symbols(symbol_table_t table) {
+
+    size_t count = 0;
+
+    for(int i = 0; i < NUM_STRIPES; i++) {
+        pthread_mutex_lock(&table->stripes[i].lock);
+        count += table->stripes[i].table->count;
+        pthread_mutex_unlock(&table->stripes[i].lock);
+    }
+    return count;
+}
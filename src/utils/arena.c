@@ -0,0 +1,235 @@
+/*
+ * Arena allocator.
+ *
+ * Allocations are taken from the front of the current block. When it is full
+ * a new block is started. Something bigger than a quarter of a block gets a
+ * block of its own, which is put behind the current one so the space left in
+ * the current one is not lost.
+ */
+#include <pthread.h>
+
+#include "common.h"
+
+#define ARENA_ALIGN 8
+#define ALIGN_UP(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+static arena_block_t* new_block(size_t size) {
+
+    arena_block_t* block = MALLOC(sizeof(arena_block_t) + size);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+arena_t* create_arena(size_t block_size) {
+
+    arena_t* arena = MALLOC(sizeof(arena_t));
+    arena->block_size = ALIGN_UP(block_size);
+    arena->blocks = NULL;
+    arena->last = NULL;
+    return arena;
+}
+
+void destroy_arena(arena_t* arena) {
+
+    if(arena != NULL) {
+        arena_block_t* next;
+        for(arena_block_t* block = arena->blocks; block != NULL; block = next) {
+            next = block->next;
+            FREE(block);
+        }
+        FREE(arena);
+    }
+}
+
+#ifdef _ARENA_QUARANTINE
+/*
+ * Arenas that were retired are kept here, filled with a pattern, until more
+ * have been retired after them. A pointer that is read out of one is not a
+ * valid address, so following it faults right away. When an arena leaves, it
+ * is checked to see that nothing wrote to it.
+ */
+#define QUARANTINE_SIZE 4
+#define POISON 0xA5
+
+static arena_t* quarantine[QUARANTINE_SIZE];
+static int quarantine_next = 0;
+static pthread_mutex_t quarantine_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void check_poison(arena_t* arena) {
+
+    for(arena_block_t* block = arena->blocks; block != NULL; block = block->next)
+        for(size_t i = 0; i < block->size; i++)
+            if((unsigned char)block->data[i] != POISON)
+                fatal_error("retired arena %p was written at %p", arena, &block->data[i]);
+}
+
+typedef struct {
+    const char* start;
+    const char* end;
+} block_range_t;
+
+typedef struct {
+    block_range_t* ranges;
+    size_t count;
+} retired_ranges_t;
+
+static int compare_ranges(const void* a, const void* b) {
+
+    const char* x = ((const block_range_t*)a)->start;
+    const char* y = ((const block_range_t*)b)->start;
+    return (x > y) - (x < y);
+}
+
+static int in_retired_block(const void* ptr, void* ctx) {
+
+    retired_ranges_t* r = ctx;
+    size_t low = 0, high = r->count;
+
+    // find the last block that starts at or before the pointer
+    while(low < high) {
+        size_t mid = (low + high) / 2;
+        if(r->ranges[mid].start <= (const char*)ptr)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low > 0 && (const char*)ptr < r->ranges[low - 1].end;
+}
+
+/*
+ * Fail if a watched hash table still has a pointer into the arena.
+ */
+static void check_stale_references(arena_t* arena) {
+
+    retired_ranges_t r = {NULL, 0};
+
+    for(arena_block_t* block = arena->blocks; block != NULL; block = block->next)
+        r.count++;
+    if(r.count == 0)
+        return;
+
+    r.ranges = MALLOC(r.count * sizeof(block_range_t));
+    size_t i = 0;
+    for(arena_block_t* block = arena->blocks; block != NULL; block = block->next, i++) {
+        r.ranges[i].start = block->data;
+        r.ranges[i].end = block->data + block->size;
+    }
+    qsort(r.ranges, r.count, sizeof(block_range_t), compare_ranges);
+
+    check_watched_tables(in_retired_block, &r);
+    FREE(r.ranges);
+}
+#endif
+
+/*
+ * Destroy an arena that other things may have pointed into. When built with
+ * _ARENA_QUARANTINE, the watched hash tables are checked for pointers into
+ * it, and the memory is kept for a while to catch anything else that still
+ * uses it.
+ */
+void retire_arena(arena_t* arena) {
+
+#ifdef _ARENA_QUARANTINE
+    if(arena == NULL)
+        return;
+
+    check_stale_references(arena);
+    for(arena_block_t* block = arena->blocks; block != NULL; block = block->next)
+        memset(block->data, POISON, block->size);
+
+    pthread_mutex_lock(&quarantine_lock);
+    arena_t* old = quarantine[quarantine_next];
+    quarantine[quarantine_next] = arena;
+    quarantine_next = (quarantine_next + 1) % QUARANTINE_SIZE;
+    pthread_mutex_unlock(&quarantine_lock);
+
+    if(old != NULL) {
+        check_poison(old);
+        destroy_arena(old);
+    }
+#else
+    destroy_arena(arena);
+#endif
+}
+
+/*
+ * Check and free the arenas that are still in quarantine.
+ */
+void flush_quarantine(void) {
+
+#ifdef _ARENA_QUARANTINE
+    pthread_mutex_lock(&quarantine_lock);
+    for(int i = 0; i < QUARANTINE_SIZE; i++) {
+        if(quarantine[i] != NULL) {
+            check_poison(quarantine[i]);
+            destroy_arena(quarantine[i]);
+            quarantine[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&quarantine_lock);
+#endif
+}
+
+/*
+ * Return memory that is aligned for any of the basic types. It is not
+ * cleared.
+ */
+void* arena_alloc(arena_t* arena, size_t size) {
+
+    arena_block_t* block = arena->blocks;
+
+    size = ALIGN_UP(size);
+    if(size > arena->block_size / 4) {
+        block = new_block(size);
+        if(arena->blocks != NULL) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        }
+        else
+            arena->blocks = block;
+    }
+    else if(block == NULL || block->size - block->used < size) {
+        block = new_block(arena->block_size);
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void* ptr = block->data + block->used;
+    block->used += size;
+    arena->last = ptr;
+    return ptr;
+}
+
+/*
+ * Make an allocation bigger. If it was the last thing allocated and there is
+ * room after it, it grows where it is. Otherwise it is copied, and the old
+ * space is not used again until the arena is destroyed.
+ */
+void* arena_grow(arena_t* arena, void* ptr, size_t old_size, size_t new_size) {
+
+    arena_block_t* block = arena->blocks;
+
+    if(ptr != NULL && ptr == arena->last && block != NULL &&
+            (char*)ptr >= block->data && (char*)ptr < block->data + block->size) {
+        size_t start = (char*)ptr - block->data;
+        if(start + ALIGN_UP(new_size) <= block->size) {
+            block->used = start + ALIGN_UP(new_size);
+            return ptr;
+        }
+    }
+
+    void* nptr = arena_alloc(arena, new_size);
+    if(ptr != NULL)
+        memcpy(nptr, ptr, old_size);
+    return nptr;
+}
+
+char* arena_strndup(arena_t* arena, const char* str, size_t len) {
+
+    char* ptr = arena_alloc(arena, len + 1);
+    memcpy(ptr, str, len);
+    ptr[len] = '\0';
+    return ptr;
+}
@@ -0,0 +1,165 @@
+/*
+ * The atom pool.
+ *
+ * The text of each atom is kept in an arena, after a header with its hash
+ * and length. The pool is an open addressed table of the atoms, which is
+ * looked up with the hash in the header, so the text of an atom is only
+ * compared when the hashes are the same. The pool is shared by everything
+ * that is running, so it is locked. An atom never changes once it is made, so
+ * reading one takes no lock.
+ */
+#include <pthread.h>
+#include <stddef.h>
+
+#include "common.h"
+
+typedef struct {
+    uint32_t hash;
+    uint32_t len;
+    char text[];
+} atom_header_t;
+
+#define ATOM_HEADER(a) ((atom_header_t*)((a) - offsetof(atom_header_t, text)))
+
+static arena_t* arena = NULL;
+static atom_t* table = NULL;
+static size_t capacity = 0;     // always a power of 2
+static size_t count = 0;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * FNV-1a, the same as the hash table.
+ */
+static uint32_t hash_text(const char* str, size_t len) {
+
+    uint32_t hash = 2166136261u;
+
+    for(size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+/*
+ * The slot of the atom with the text, or the empty slot where it would go.
+ */
+static atom_t* find_slot(const char* str, size_t len, uint32_t hash) {
+
+    size_t index = hash & (capacity - 1);
+
+    while(table[index] != NULL) {
+        atom_header_t* head = ATOM_HEADER(table[index]);
+        if(head->hash == hash && head->len == len && !memcmp(head->text, str, len))
+            break;
+        index = (index + 1) & (capacity - 1);
+    }
+    return &table[index];
+}
+
+static void grow_pool(void) {
+
+    size_t old_cap = capacity;
+    atom_t* old = table;
+
+    capacity = (capacity == 0)? 1024: capacity * 2;
+    table = CALLOC(capacity, sizeof(atom_t));
+    if(arena == NULL)
+        arena = create_arena(1024*64);
+
+    for(size_t i = 0; i < old_cap; i++) {
+        if(old[i] != NULL) {
+            size_t index = ATOM_HEADER(old[i])->hash & (capacity - 1);
+            while(table[index] != NULL)
+                index = (index + 1) & (capacity - 1);
+            table[index] = old[i];
+        }
+    }
+    if(old != NULL)
+        FREE(old);
+}
+
+/*
+ * Give the atom for the text, making it if it is new. The text does not have
+ * to be terminated.
+ */
+atom_t intern_atom(const char* str, size_t len) {
+
+    uint32_t hash = hash_text(str, len);
+
+    if(len >= UINT32_MAX)
+        fatal_error("cannot make an atom of %zu characters", len);
+
+    pthread_mutex_lock(&lock);
+
+    if((count + 1) * 4 > capacity * 3)
+        grow_pool();
+
+    atom_t* slot = find_slot(str, len, hash);
+    if(*slot == NULL) {
+        atom_header_t* head = arena_alloc(arena, sizeof(atom_header_t) + len + 1);
+        head->hash = hash;
+        head->len = len;
+        memcpy(head->text, str, len);
+        head->text[len] = '\0';
+        *slot = head->text;
+        count++;
+    }
+    atom_t atom = *slot;
+
+    pthread_mutex_unlock(&lock);
+    return atom;
+}
+
+atom_t intern_string(const char* str) {
+
+    return intern_atom(str, strlen(str));
+}
+
+/*
+ * Give the atom for the text if there is one, or NULL. A name that was never
+ * interned cannot be in anything that is keyed by atoms.
+ */
+atom_t find_atom(const char* str, size_t len) {
+
+    uint32_t hash = hash_text(str, len);
+    atom_t atom = NULL;
+
+    pthread_mutex_lock(&lock);
+    if(capacity != 0)
+        atom = *find_slot(str, len, hash);
+    pthread_mutex_unlock(&lock);
+
+    return atom;
+}
+
+uint32_t atom_hash(atom_t atom) {
+
+    return ATOM_HEADER(atom)->hash;
+}
+
+size_t atom_length(atom_t atom) {
+
+    return ATOM_HEADER(atom)->len;
+}
+
+size_t num_atoms(void) {
+
+    return count;
+}
+
+/*
+ * Free every atom. Nothing that holds one can use it after this.
+ */
+void destroy_atoms(void) {
+
+    pthread_mutex_lock(&lock);
+    if(table != NULL)
+        FREE(table);
+    destroy_arena(arena);
+    table = NULL;
+    arena = NULL;
+    capacity = 0;
+    count = 0;
+    pthread_mutex_unlock(&lock);
+}
@@ -42,7 +42,7 @@ static unsigned char* list_at_index(data_list_t* list, int index)
  */
 void destroy_data_list(data_list_t* list)
 {
-    if(list->buffer != NULL && list->nitems != 0)
+    if(list->buffer != NULL)
         FREE(list->buffer);
     FREE(list);
 }
@@ -16,6 +16,10 @@ static struct errors
     int warnings;
 } errors;
 
+// Messages are reported at the location of the scanner that is running on
+// this thread.
+static __thread scanner_t* err_scanner = NULL;
+
 /*
  *  Initialize the errors and logging system.
  */
@@ -28,9 +32,21 @@ void init_errors(int level, FILE* stre)
     errors.warnings = 0;
 }
 
-void inc_error_count(void) { errors.errors++; }
+/*
+ * Set the scanner that is used to locate messages on this thread. Returns the
+ * one that was set before.
+ */
+scanner_t* set_error_scanner(scanner_t* scan) {
+
+    scanner_t* prev = err_scanner;
+    err_scanner = scan;
+    return prev;
+}
+
+// the counts are shared by all of the threads
+void inc_error_count(void) { __atomic_add_fetch(&errors.errors, 1, __ATOMIC_RELAXED); }
 
-void inc_warning_count(void) { errors.warnings++; }
+void inc_warning_count(void) { __atomic_add_fetch(&errors.warnings, 1, __ATOMIC_RELAXED); }
 
 void set_error_level(int lev) { errors.level = lev; }
 
@@ -47,9 +63,9 @@ int get_num_warnings(void) { return errors.warnings; }
 void syntax(char* str, ...)
 {
     va_list args;
-    const char* name = get_file_name();
-    int lnum = get_line_number();
-    int cnum = get_col_number();
+    const char* name = get_file_name(err_scanner);
+    int lnum = get_line_number(err_scanner);
+    int cnum = get_col_number(err_scanner);
 
     if(NULL != name)
         fprintf(stderr, "Syntax: %s: %d: %d: ", name, lnum, cnum);
@@ -60,25 +76,25 @@ void syntax(char* str, ...)
     vfprintf(stderr, str, args);
     va_end(args);
     fprintf(stderr, "\n");
-    errors.errors++;
+    inc_error_count();
 }
 
-int expect_token(scanner_state_t* ss, int expect) {
+int expect_token(scanner_t* scan, token_slice_t* tok, int expect) {
 
-    int tok = get_token(ss);
+    *tok = get_token(scan);
 
-    if(expect != tok) {
-        syntax("expected %s but got %s", tok_to_strg(expect), tok_to_strg(tok));
+    if(expect != tok->kind) {
+        syntax("expected %s but got %s", tok_to_strg(expect), tok_to_strg(tok->kind));
         return ERROR_TOKEN;
     }
 
-    return tok;
+    return tok->kind;
 }
 
-int expect_token_list(scanner_state_t* ss, int num, ...) {
+int expect_token_list(scanner_t* scan, token_slice_t* tok, int num, ...) {
 
     va_list(args);
-    int tok = get_token(ss);
+    *tok = get_token(scan);
     char buffer[1024];
     int expect;
 
@@ -86,8 +102,8 @@ int expect_token_list(scanner_state_t* ss, int num, ...) {
     va_start(args, num);
     for(int i = 0; i < num; i++) {
         expect = va_arg(args, int);
-        if(tok == expect)
-            return tok;
+        if(tok->kind == expect)
+            return tok->kind;
         else {
             STRNCAT(buffer, tok_to_strg(expect), sizeof(buffer));
             if(i+1 < num)
@@ -95,7 +111,7 @@ int expect_token_list(scanner_state_t* ss, int num, ...) {
         }
     }
 
-    syntax("expected %s but got %s", buffer, tok_to_strg(tok));
+    syntax("expected %s but got %s", buffer, tok_to_strg(tok->kind));
 
     return ERROR_TOKEN;
 }
@@ -103,9 +119,9 @@ int expect_token_list(scanner_state_t* ss, int num, ...) {
 void scanner_error(char* str, ...)
 {
     va_list args;
-    const char* name = get_file_name();
-    int lnum = get_line_number();
-    int cnum = get_col_number();
+    const char* name = get_file_name(err_scanner);
+    int lnum = get_line_number(err_scanner);
+    int cnum = get_col_number(err_scanner);
 
     if(NULL != name)
         fprintf(stderr, "Scanner Error: %s: %d: %d: ", name, lnum, cnum);
@@ -116,15 +132,15 @@ void scanner_error(char* str, ...)
     vfprintf(stderr, str, args);
     va_end(args);
     fprintf(stderr, "\n");
-    errors.errors++;
+    inc_error_count();
 }
 
 void warning(char* str, ...)
 {
     va_list args;
-    const char* name = get_file_name();
-    int lnum = get_line_number();
-    int cnum = get_col_number();
+    const char* name = get_file_name(err_scanner);
+    int lnum = get_line_number(err_scanner);
+    int cnum = get_col_number(err_scanner);
 
     if(NULL != name)
         fprintf(stderr, "Warning: %s: %d: %d: ", name, lnum, cnum);
@@ -135,7 +151,7 @@ void warning(char* str, ...)
     vfprintf(stderr, str, args);
     va_end(args);
     fprintf(stderr, "\n");
-    errors.warnings++;
+    inc_warning_count();
 }
 
 void debug(int lev, char* str, ...)
@@ -183,7 +199,7 @@ void debug_trace(int lev, const char *str, ...) {
         else
             ofp = stderr;
 
-        fprintf(ofp, "TRACE: %s: %d: %d: ", clip_path(get_file_name()), get_line_number(), get_col_number());
+        fprintf(ofp, "TRACE: %s: %d: %d: ", clip_path(get_file_name(err_scanner)), get_line_number(err_scanner), get_col_number(err_scanner));
         va_start(args, str);
         vfprintf(ofp, str, args);
         va_end(args);
@@ -201,7 +217,7 @@ void debug_mark(int lev, const char *file, int line, const char *func) {
         else
             ofp = stderr;
 
-        fprintf(ofp, "MARK: (%s, %d) %s: %d: %d: %s\n", file, line, clip_path(get_file_name()), get_line_number(), get_col_number(), func);
+        fprintf(ofp, "MARK: (%s, %d) %s: %d: %d: %s\n", file, line, clip_path(get_file_name(err_scanner)), get_line_number(err_scanner), get_col_number(err_scanner), func);
         //fprintf(ofp, "      %s: %d\n", file, line);
     }
 }
@@ -0,0 +1,106 @@
+/*
+ * Bring a whole file into memory so that it can be scanned in place. The file
+ * is either mapped or read with one call into a single allocation. Either way
+ * the text is writable, because flex writes into the buffer as it scans, and
+ * it is followed by FILE_MAP_PAD zero bytes.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "common.h"
+
+/*
+ * Map the file privately so that writes do not go back to the file. The
+ * padding could fall on a page that is past the end of the file, which
+ * would fault, so an anonymous region of the full length is reserved first
+ * and the file is mapped over the front of it.
+ */
+static int map_text(file_map_t* fm, int fd) {
+
+    fm->length = fm->size + FILE_MAP_PAD;
+    fm->base = mmap(NULL, fm->length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(fm->base == MAP_FAILED)
+        return -1;
+
+    if(fm->size > 0) {
+        if(MAP_FAILED == mmap(fm->base, fm->size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_FIXED, fd, 0)) {
+            int err = errno;
+            munmap(fm->base, fm->length);
+            errno = err;
+            return -1;
+        }
+    }
+
+    fm->mapped = 1;
+    return 0;
+}
+
+/*
+ * Read the file with one call into a buffer that has room for the padding.
+ */
+static int read_text(file_map_t* fm, int fd) {
+
+    fm->length = fm->size + FILE_MAP_PAD;
+    fm->base = MALLOC(fm->length);
+
+    size_t total = 0;
+    while(total < fm->size) {
+        ssize_t n = read(fd, fm->base + total, fm->size - total);
+        if(n <= 0) {
+            int err = (n < 0)? errno: EIO;
+            FREE(fm->base);
+            errno = err;
+            return -1;
+        }
+        total += n;
+    }
+
+    memset(fm->base + fm->size, 0, FILE_MAP_PAD);
+    fm->mapped = 0;
+    return 0;
+}
+
+/*
+ * Returns 0 on success. On failure returns -1 and leaves errno set.
+ */
+int map_file(file_map_t* fm, const char* fname, int use_mmap) {
+
+    struct stat st;
+    int retv;
+
+    memset(fm, 0, sizeof(file_map_t));
+
+    int fd = open(fname, O_RDONLY);
+    if(fd < 0)
+        return -1;
+
+    if(fstat(fd, &st) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    fm->size = st.st_size;
+
+    if(use_mmap)
+        retv = map_text(fm, fd);
+    else
+        retv = read_text(fm, fd);
+
+    int err = errno;
+    close(fd);
+    errno = err;
+    return retv;
+}
+
+void unmap_file(file_map_t* fm) {
+
+    if(fm->base != NULL) {
+        if(fm->mapped)
+            munmap(fm->base, fm->length);
+        else
+            FREE(fm->base);
+    }
+    memset(fm, 0, sizeof(file_map_t));
+}
@@ -1,12 +1,18 @@
 /*
- * Hash table uses the
- *
+ * Hash table uses the open addressing with linear probing. The hash of each
+ * key is kept in its entry, so a probe only compares the strings when the
+ * hashes are the same, and growing the table does not hash the keys again.
+ * A removed entry becomes a tombstone, which probes go past and inserts use
+ * again.
  */
 
 #include "common.h"
 
 #define TABLE_MAX_LOAD 0.75
 
+static char tombstone;
+#define TOMBSTONE ((void*)&tombstone)
+
 /*
  * Return the smaller of the two parameters.
  */
@@ -15,40 +21,68 @@ static inline size_t _min(size_t v1, size_t v2) { return (v1 < v2) ? v1 : v2; }
 /*
  * This is a “FNV-1a” hash function. Do not mess with the constants.
  */
-static uint32_t make_hash(const char* key)
+uint32_t make_hash(const char* key)
 {
     uint32_t hash = 2166136261u;
 
-    for(int i = 0; i < (int)strlen(key); i++)
+    for(const char* p = key; *p != '\0'; p++)
     {
-        hash ^= key[i];
+        hash ^= (uint8_t)*p;
         hash *= 16777619;
     }
 
     return hash;
 }
 
+/*
+ * Where the data of an entry is.
+ */
+static inline void* entry_data(_table_entry_t* entry)
+{
+    return (entry->size <= HASH_INLINE_SIZE) ? entry->value.bytes : entry->value.data;
+}
+
+/*
+ * An atom already knows its hash.
+ */
+static inline uint32_t key_hash(hash_table_t* tab, const char* key)
+{
+    return tab->atom_keys ? atom_hash(key) : make_hash(key);
+}
+
 /*
  * If the entry is found, return the slot, if the entry is not found, then the
  * slot returned is where to put the entry. Check the slot's key to tell the
- * difference.
+ * difference. The place to put an entry is the first tombstone on the way, if
+ * there is one.
  */
-static _table_entry_t* find_slot(_table_entry_t* ent, size_t cap, const char* key)
+static _table_entry_t* find_slot(hash_table_t* tab, const char* key, uint32_t hash)
 {
-    uint32_t index = make_hash(key) & (cap - 1);
+    _table_entry_t* ent = tab->entries;
+    size_t cap = tab->capacity;
+    uint32_t index = hash & (cap - 1);
+    _table_entry_t* first_tombstone = NULL;
 
     while(1)
     {
         _table_entry_t* entry = &ent[index];
 
-        // depends on left evaluate before right
-        if((entry->key == NULL) || (!strcmp(key, entry->key)))
+        if(entry->key == NULL)
         {
+            if(entry->value.data != TOMBSTONE)
+            {
 #ifdef __TESTING_HASH_TABLE_C__
-            if(entry->key != NULL)
-                printf("found: index: %-2u key: %-12s value: %s\n", index, key, (char*)entry->data);
-            else
                 printf("insert: index: %-2u key: %-12s\n", index, key);
+#endif
+                return (first_tombstone != NULL) ? first_tombstone : entry;
+            }
+            if(first_tombstone == NULL)
+                first_tombstone = entry;
+        }
+        else if(entry->hash == hash && (tab->atom_keys ? entry->key == key : !strcmp(key, entry->key)))
+        {
+#ifdef __TESTING_HASH_TABLE_C__
+            printf("found: index: %-2u key: %-12s value: %s\n", index, key, (char*)entry_data(entry));
 #endif
             return entry;
         }
@@ -58,13 +92,15 @@ static _table_entry_t* find_slot(_table_entry_t* ent, size_t cap, const char* ke
 }
 
 /*
- * Grow the table if it needs it. Since the hash values change when the table
- * size changes, this function simply re-adds them to the new table, then
- * updates the data structure.
+ * Grow the table if it needs it. Since the slots change when the table size
+ * changes, this function simply re-adds them to the new table, then updates
+ * the data structure. Tombstones count toward the load, because probes have to
+ * go past them. They are not copied, so if most of the load is tombstones, the
+ * table is rebuilt at the same size instead of growing.
  */
 static void grow_table(hash_table_t* tab)
 {
-    if(tab->count + 2 > tab->capacity * TABLE_MAX_LOAD)
+    if(tab->count + tab->tombstones + 2 > tab->capacity * TABLE_MAX_LOAD)
     {
 #ifdef __TESTING_HASH_TABLE_C__
         printf("\ngrowing table\n");
@@ -72,7 +108,9 @@ static void grow_table(hash_table_t* tab)
         printf("  table count: %lu\n", tab->count);
 #endif
         // table must always be an even power of 2 for this to work.
-        size_t capacity = tab->capacity << 1;
+        size_t capacity = tab->capacity;
+        if(tab->count + 2 > capacity * TABLE_MAX_LOAD / 2)
+            capacity <<= 1;
 
         _table_entry_t* entries = (_table_entry_t*)CALLOC(capacity, sizeof(_table_entry_t));
 
@@ -85,21 +123,21 @@ static void grow_table(hash_table_t* tab)
             {
                 if(tab->entries[i].key != NULL)
                 {
-                    _table_entry_t* ent = find_slot(entries, capacity, tab->entries[i].key);
-
-                    // if the key is the same, (i.e. not NULL) the replace the data. There
-                    // can be no duplicate entries. No need to check it.
-                    ent->key = tab->entries[i].key;
-                    ent->size = tab->entries[i].size;
-                    ent->data = tab->entries[i].data;
+                    // There can be no duplicate entries, so the first empty
+                    // slot is the place. No need to compare the keys.
+                    uint32_t index = tab->entries[i].hash & (capacity - 1);
+                    while(entries[index].key != NULL)
+                        index = (index + 1) & (capacity - 1);
+                    entries[index] = tab->entries[i];
                 }
             }
             // free the old table
-            free(tab->entries);
+            FREE(tab->entries);
         }
 
         tab->entries = entries;
         tab->capacity = capacity;
+        tab->tombstones = 0;
 #ifdef __TESTING_HASH_TABLE_C__
         printf("\nfinished growing table\n");
         printf("  table capacity: %lu\n", tab->capacity);
@@ -118,11 +156,27 @@ hash_table_t* create_hash_table(void)
         fatal_error("cannot allocate %lu bytes for hash table structure", sizeof(hash_table_t));
     }
 
+    tab->count = 0;
+    tab->tombstones = 0;
+    tab->atom_keys = 0;
+    tab->iter = 0;
     tab->capacity = 0x01 << 3;
     tab->entries = (_table_entry_t*)CALLOC(tab->capacity, sizeof(_table_entry_t));
     return tab;
 }
 
+/*
+ * A table whose keys are atoms. The keys are not copied, and they are the
+ * same key only if they are the same atom, so every key given to the table
+ * has to be an atom.
+ */
+hash_table_t* create_atom_hash_table(void)
+{
+    hash_table_t* tab = create_hash_table();
+    tab->atom_keys = 1;
+    return tab;
+}
+
 void destroy_hash_table(hash_table_t* tab)
 {
     if(tab != NULL)
@@ -131,10 +185,13 @@ void destroy_hash_table(hash_table_t* tab)
         {
             for(int i = 0; i < (int)tab->capacity; i++)
             {
-                if(tab->entries[i].data != NULL)
-                    FREE(tab->entries[i].data);
                 if(tab->entries[i].key != NULL)
-                    FREE((void*)tab->entries[i].key);
+                {
+                    if(tab->entries[i].size > HASH_INLINE_SIZE)
+                        FREE(tab->entries[i].value.data);
+                    if(!tab->atom_keys)
+                        FREE((void*)tab->entries[i].key);
+                }
             }
             FREE(tab->entries);
         }
@@ -149,20 +206,31 @@ int insert_hash_table(hash_table_t* tab, const char* key, void* data, size_t siz
 {
     grow_table(tab);
 
-    _table_entry_t* entry = find_slot(tab->entries, tab->capacity, key);
+    uint32_t hash = key_hash(tab, key);
+    _table_entry_t* entry = find_slot(tab, key, hash);
     int retv = (entry->key == NULL) ? HASH_NO_ERROR : HASH_EXIST;
 
     if(retv == HASH_NO_ERROR) {
-        entry->key = STRDUP(key);
+        if(entry->value.data == TOMBSTONE)
+            tab->tombstones--;
+        entry->hash = hash;
+        entry->key = tab->atom_keys ? key : STRDUP(key);
         if(entry->key == NULL)
             fatal_error("cannot allocate %lu bytes for hash table key", strlen(key));
 
-        entry->data = MALLOC(size);
-        if(entry->data == NULL)
-            fatal_error("cannot allocate %lu bytes for hash table data", size);
+        if(size >= UINT32_MAX)
+            fatal_error("cannot keep %lu bytes of hash table data", size);
 
-        memcpy(entry->data, data, size);
         entry->size = size;
+        if(size > HASH_INLINE_SIZE)
+        {
+            entry->value.data = MALLOC(size);
+            if(entry->value.data == NULL)
+                fatal_error("cannot allocate %lu bytes for hash table data", size);
+        }
+
+        if(size > 0)
+            memcpy(entry_data(entry), data, size);
         tab->count++;
     }
 
@@ -171,16 +239,16 @@ int insert_hash_table(hash_table_t* tab, const char* key, void* data, size_t siz
 
 int find_hash_table(hash_table_t* tab, const char* key, void* data, size_t size)
 {
-    _table_entry_t* entry = find_slot(tab->entries, tab->capacity, key);
+    _table_entry_t* entry = find_slot(tab, key, key_hash(tab, key));
     int retv = HASH_NO_ERROR;
 
     if(entry->key != NULL)
     {
-        if(entry->data != NULL)
+        if(data != NULL)
         {
             //if(entry->size != size)
             //    retv = HASH_DATA_SIZE;
-            memcpy(data, entry->data, _min(size, entry->size));
+            memcpy(data, entry_data(entry), _min(size, entry->size));
         }
         //else
         //    retv = HASH_NO_DATA;
@@ -191,9 +259,44 @@ int find_hash_table(hash_table_t* tab, const char* key, void* data, size_t size)
     return retv;
 }
 
+/*
+ * Return where the data of the entry is kept, so that it can be read or
+ * changed without a copy, or NULL if the key is not there. The pointer is good
+ * until something is added to or removed from the table.
+ */
+void* find_hash_table_data(hash_table_t* tab, const char* key)
+{
+    _table_entry_t* entry = find_slot(tab, key, key_hash(tab, key));
+
+    return (entry->key != NULL) ? entry_data(entry) : NULL;
+}
+
+/*
+ * Take an entry out of the table and free its key and data.
+ */
+int remove_hash_table(hash_table_t* tab, const char* key)
+{
+    _table_entry_t* entry = find_slot(tab, key, key_hash(tab, key));
+
+    if(entry->key == NULL)
+        return HASH_NOT_FOUND;
+
+    if(!tab->atom_keys)
+        FREE((void*)entry->key);
+    if(entry->size > HASH_INLINE_SIZE)
+        FREE(entry->value.data);
+    entry->key = NULL;
+    entry->value.data = TOMBSTONE;
+    entry->size = 0;
+    tab->count--;
+    tab->tombstones++;
+
+    return HASH_NO_ERROR;
+}
+
 size_t find_hash_table_entry_size(hash_table_t* tab, const char* key) {
 
-    _table_entry_t* entry = find_slot(tab->entries, tab->capacity, key);
+    _table_entry_t* entry = find_slot(tab, key, key_hash(tab, key));
     size_t retv = 0;
 
     if(entry->key != NULL) {
@@ -205,21 +308,129 @@ size_t find_hash_table_entry_size(hash_table_t* tab, const char* key) {
 
 /*
  * Iterate all of the keys in the hash table. Used for various dump utilities.
+ * Only one of these walks can be going on for a table. Use a cursor when
+ * more are needed.
  *
  * Make reset != 0 to reset to the beginning of the table.
  */
 const char* iterate_hash_table(hash_table_t* tab, int reset) {
 
-    static int ht_index = -1;
+    for(tab->iter = reset ? 0 : tab->iter; tab->iter < tab->capacity; tab->iter++) {
+        if(tab->entries[tab->iter].key != NULL) {
+            return tab->entries[tab->iter++].key;
+        }
+    }
+
+    return NULL;
+}
 
-    if(reset)
-        ht_index = -1;
+void init_hash_cursor(hash_cursor_t* cur) {
 
-    for(ht_index++; ht_index < tab->capacity; ht_index++) {
-        if(tab->entries[ht_index].key != NULL) {
-            return tab->entries[ht_index].key;
+    memset(cur, 0, sizeof(hash_cursor_t));
+}
+
+/*
+ * Move the cursor to the next entry. Returns 1 if there is one, or 0 when the
+ * walk is finished.
+ */
+int next_hash_entry(hash_table_t* tab, hash_cursor_t* cur) {
+
+    while(cur->index < tab->capacity) {
+        _table_entry_t* entry = &tab->entries[cur->index++];
+        if(entry->key != NULL) {
+            cur->key = entry->key;
+            cur->data = entry_data(entry);
+            cur->size = entry->size;
+            return 1;
         }
     }
 
-    return NULL;
+    return 0;
+}
+
+#ifdef _ARENA_QUARANTINE
+typedef struct {
+    hash_table_t* table;
+    pthread_mutex_t* lock;  // held while the table is searched, if not NULL
+} watched_table_t;
+
+static watched_table_t* watched = NULL;
+static size_t num_watched = 0;
+static size_t max_watched = 0;
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void watch_hash_table(hash_table_t* tab, pthread_mutex_t* lock) {
+
+#ifdef _ARENA_QUARANTINE
+    pthread_mutex_lock(&watch_lock);
+    if(num_watched >= max_watched) {
+        max_watched = (max_watched == 0)? 16: max_watched * 2;
+        watched = REALLOC(watched, max_watched * sizeof(watched_table_t));
+    }
+    watched[num_watched].table = tab;
+    watched[num_watched].lock = lock;
+    num_watched++;
+    pthread_mutex_unlock(&watch_lock);
+#else
+    (void)tab;
+    (void)lock;
+#endif
+}
+
+void unwatch_hash_table(hash_table_t* tab) {
+
+#ifdef _ARENA_QUARANTINE
+    pthread_mutex_lock(&watch_lock);
+    for(size_t i = 0; i < num_watched; i++)
+        if(watched[i].table == tab) {
+            watched[i] = watched[--num_watched];
+            break;
+        }
+    if(num_watched == 0 && watched != NULL) {
+        FREE(watched);
+        watched = NULL;
+        max_watched = 0;
+    }
+    pthread_mutex_unlock(&watch_lock);
+#else
+    (void)tab;
+#endif
+}
+
+/*
+ * Fail if the key or any pointer sized word of the data of an entry in a
+ * watched table is somewhere that inside() says is gone.
+ */
+void check_watched_tables(int (*inside)(const void* ptr, void* ctx), void* ctx) {
+
+#ifdef _ARENA_QUARANTINE
+    hash_cursor_t cur;
+
+    pthread_mutex_lock(&watch_lock);
+    for(size_t i = 0; i < num_watched; i++) {
+        if(watched[i].lock != NULL)
+            pthread_mutex_lock(watched[i].lock);
+
+        init_hash_cursor(&cur);
+        while(next_hash_entry(watched[i].table, &cur)) {
+            if(inside(cur.key, ctx))
+                fatal_error("hash table %p has a key in a retired arena", watched[i].table);
+            for(size_t off = 0; off + sizeof(void*) <= cur.size; off += sizeof(void*)) {
+                void* ptr;
+                memcpy(&ptr, (char*)cur.data + off, sizeof(ptr));
+                if(inside(ptr, ctx))
+                    fatal_error("hash table %p still points into a retired arena at %p for \"%s\"",
+                                watched[i].table, ptr, cur.key);
+            }
+        }
+
+        if(watched[i].lock != NULL)
+            pthread_mutex_unlock(watched[i].lock);
+    }
+    pthread_mutex_unlock(&watch_lock);
+#else
+    (void)inside;
+    (void)ctx;
+#endif
 }
@@ -0,0 +1,256 @@
+/*
+ * Map source locations back to the file, line, and column.
+ *
+ * The files are kept in the order that they were added, which is also the
+ * order of their ranges, so a location is found with a binary search. The
+ * table is shared by every scanner, so it is locked.
+ *
+ * Every file belongs to an owner, which is the compilation that opened it.
+ * When a file is closed its text is handed to the table, and it stays until
+ * the owner releases its files. So the starts of the lines in a file are only
+ * found if a location in it is asked for, and a batch of compilations does
+ * not keep the files of the ones that are finished. The locations past the
+ * last file that is still kept are given out again. Flex writes into the text
+ * while it scans it, so a file that flex reads has its lines found before flex
+ * starts, see index_source_lines().
+ *
+ * The memory here does not come from MALLOC() and friends, because they can
+ * report a trace message, and reporting a message looks up the location,
+ * which would wait on the lock that is already held.
+ */
+#include <pthread.h>
+
+#include "common.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define USE_X86_SIMD
+#  include <emmintrin.h>
+#endif
+
+typedef struct {
+    char* name;
+    const void* owner;      // what releases the file
+    source_loc_t base;      // location of the first character
+    uint32_t size;
+    const char* text;
+    file_map_t map;         // the text once the file is closed, if it was kept
+    uint32_t* lines;        // offset of the start of each line
+    uint32_t num_lines;
+} source_file_t;
+
+static source_file_t* files = NULL;
+static int num_files = 0;
+static int max_files = 0;
+static source_loc_t next_base = 1;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Count the newlines in the text. If lines is not NULL, the offset of the
+ * character after each newline is stored in it as well.
+ */
+static uint32_t find_newlines(const char* text, uint32_t size, uint32_t* lines) {
+
+    uint32_t count = 0;
+    uint32_t i = 0;
+
+#ifdef USE_X86_SIMD
+    for(; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(text + i));
+        uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        if(lines == NULL)
+            count += __builtin_popcount(mask);
+        else {
+            for(; mask != 0; mask &= mask - 1)
+                lines[count++] = i + __builtin_ctz(mask) + 1;
+        }
+    }
+#endif
+
+    for(; i < size; i++) {
+        if(text[i] == '\n') {
+            if(lines != NULL)
+                lines[count] = i + 1;
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Count the newlines, then go through again to note where each line starts.
+ */
+static void build_line_index(source_file_t* file) {
+
+    uint32_t count = find_newlines(file->text, file->size, NULL) + 1;
+
+    file->lines = malloc(count * sizeof(uint32_t));
+    if(file->lines == NULL)
+        fatal_error("cannot allocate the line index for \"%s\"", file->name);
+    file->lines[0] = 0;
+    find_newlines(file->text, file->size, file->lines + 1);
+    file->num_lines = count;
+}
+
+static source_file_t* find_file(source_loc_t loc) {
+
+    int lo = 0;
+    int hi = num_files - 1;
+
+    while(lo <= hi) {
+        int mid = (lo + hi) / 2;
+        source_file_t* file = &files[mid];
+        if(loc < file->base)
+            hi = mid - 1;
+        else if(loc > file->base + file->size)
+            lo = mid + 1;
+        else
+            return file;
+    }
+    return NULL;
+}
+
+/*
+ * Give the file a range of locations and return the first one. The text has
+ * to stay where it is until keep_source_text() is called. The file is kept
+ * until release_source_files() is called with the owner.
+ */
+source_loc_t add_source_file(const void* owner, const char* name, const char* text, size_t size) {
+
+    pthread_mutex_lock(&lock);
+
+    if(size >= UINT32_MAX || (uint64_t)next_base + size + 1 > UINT32_MAX)
+        fatal_error("too much source text for 32 bit locations at \"%s\"", name);
+
+    if(num_files >= max_files) {
+        max_files = (max_files == 0)? 16: max_files * 2;
+        files = realloc(files, max_files * sizeof(source_file_t));
+        if(files == NULL)
+            fatal_error("cannot allocate the source file table");
+    }
+
+    source_file_t* file = &files[num_files++];
+    memset(file, 0, sizeof(source_file_t));
+    file->name = strdup(name);
+    file->owner = owner;
+    file->base = next_base;
+    file->size = size;
+    file->text = text;
+    next_base += size + 1;
+
+    pthread_mutex_unlock(&lock);
+    return file->base;
+}
+
+/*
+ * Find the starts of the lines in the file now, while the text is as it was
+ * read. Call this before anything writes into the text.
+ */
+void index_source_lines(source_loc_t base) {
+
+    pthread_mutex_lock(&lock);
+
+    source_file_t* file = find_file(base);
+    if(file != NULL && file->lines == NULL)
+        build_line_index(file);
+
+    pthread_mutex_unlock(&lock);
+}
+
+/*
+ * The file is closed. The table takes its text, so that the lines can still
+ * be found, and frees it when the file is released. The map is emptied.
+ */
+void keep_source_text(source_loc_t base, file_map_t* text) {
+
+    pthread_mutex_lock(&lock);
+
+    source_file_t* file = find_file(base);
+    if(file != NULL && file->map.base == NULL) {
+        file->map = *text;
+        file->text = text->base;
+        memset(text, 0, sizeof(file_map_t));
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    // a file that is not in the table has nothing to keep its text for
+    unmap_file(text);
+}
+
+/*
+ * Drop every file of the owner, with its text and its lines. No location in
+ * them can be looked up after this.
+ */
+void release_source_files(const void* owner) {
+
+    file_map_t* maps = NULL;
+    int num_maps = 0;
+
+    pthread_mutex_lock(&lock);
+
+    int kept = 0;
+    for(int i = 0; i < num_files; i++) {
+        source_file_t* file = &files[i];
+        if(file->owner == owner) {
+            if(file->map.base != NULL) {
+                // unmapped once the lock is let go, see above
+                if(maps == NULL && (maps = malloc(num_files * sizeof(file_map_t))) == NULL)
+                    fatal_error("cannot allocate the source file table");
+                maps[num_maps++] = file->map;
+            }
+            free(file->name);
+            free(file->lines);
+        }
+        else
+            files[kept++] = *file;
+    }
+    num_files = kept;
+    next_base = (num_files == 0)? 1: files[num_files - 1].base + files[num_files - 1].size + 1;
+
+    pthread_mutex_unlock(&lock);
+
+    for(int i = 0; i < num_maps; i++)
+        unmap_file(&maps[i]);
+    free(maps);
+}
+
+/*
+ * Find the file, line, and column of a location. Lines and columns start at
+ * one. Returns 0 on success or -1 if the location is not in any file.
+ */
+int get_source_location(source_loc_t loc, const char** name, int* line, int* col) {
+
+    int retv = -1;
+
+    pthread_mutex_lock(&lock);
+
+    source_file_t* file = find_file(loc);
+    if(file != NULL) {
+        if(file->lines == NULL)
+            build_line_index(file);
+
+        uint32_t off = loc - file->base;
+        uint32_t lo = 0;
+        uint32_t hi = file->num_lines;
+
+        // find the last line that starts at or before the offset
+        while(hi - lo > 1) {
+            uint32_t mid = (lo + hi) / 2;
+            if(file->lines[mid] <= off)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        if(name != NULL)
+            *name = file->name;
+        if(line != NULL)
+            *line = lo + 1;
+        if(col != NULL)
+            *col = off - file->lines[lo] + 1;
+        retv = 0;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return retv;
+}
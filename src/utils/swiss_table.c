@@ -0,0 +1,332 @@
+/*
+ * Hash table with control bytes, probed a group of 16 slots at a time.
+ *
+ * The hash of a key is split in two. The high bits pick the group where the
+ * probe starts, and the low 7 bits are kept in the control byte of the slot.
+ * A probe loads the 16 control bytes of a group and compares all of them to
+ * the low bits at once. Only the slots that match have their keys compared,
+ * so most probes look at no key that is not the one being found. A group that
+ * has an empty slot ends the probe. The groups after the first are visited
+ * with steps of 16, 32, 48, and so on, which visits every group once when the
+ * number of groups is a power of 2.
+ *
+ * The control bytes of the first group are repeated after the last slot, so a
+ * group can start at any slot and still be loaded with one read.
+ */
+#include "common.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#  define USE_X86_SIMD
+#  include <emmintrin.h>
+#endif
+
+#define GROUP_SIZE 16
+#define CTRL_EMPTY ((int8_t)-128)     // 0x80
+#define CTRL_DELETED ((int8_t)-2)     // 0xFE
+
+// the high bit is set in both of the control bytes that are not full
+#define IS_FULL(c) ((c) >= 0)
+
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((int8_t)((hash) & 0x7F))
+
+/*
+ * A bit for each slot in the group whose control byte is c.
+ */
+static inline uint32_t match_byte(const int8_t* group, int8_t c) {
+
+#ifdef USE_X86_SIMD
+    __m128i v = _mm_loadu_si128((const __m128i*)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)));
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < GROUP_SIZE; i++)
+        if(group[i] == c)
+            mask |= 1u << i;
+    return mask;
+#endif
+}
+
+/*
+ * A bit for each slot in the group that is empty or deleted.
+ */
+static inline uint32_t match_free(const int8_t* group) {
+
+#ifdef USE_X86_SIMD
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    uint32_t mask = 0;
+    for(int i = 0; i < GROUP_SIZE; i++)
+        if(!IS_FULL(group[i]))
+            mask |= 1u << i;
+    return mask;
+#endif
+}
+
+static inline void* entry_data(_table_entry_t* entry) {
+
+    return (entry->size <= HASH_INLINE_SIZE)? entry->value.bytes: entry->value.data;
+}
+
+static inline uint32_t key_hash(swiss_table_t* tab, const char* key) {
+
+    return tab->atom_keys? atom_hash(key): make_hash(key);
+}
+
+static inline void set_ctrl(swiss_table_t* tab, size_t index, int8_t c) {
+
+    tab->ctrl[index] = c;
+    if(index < GROUP_SIZE)
+        tab->ctrl[tab->capacity + index] = c;
+}
+
+/*
+ * Return the slot of the key, or -1 if it is not there.
+ */
+static ssize_t find_slot(swiss_table_t* tab, const char* key, uint32_t hash) {
+
+    size_t mask = tab->capacity - 1;
+    size_t pos = H1(hash) & mask;
+    int8_t h2 = H2(hash);
+
+    for(size_t step = GROUP_SIZE; ; step += GROUP_SIZE) {
+        const int8_t* group = &tab->ctrl[pos];
+
+        for(uint32_t m = match_byte(group, h2); m != 0; m &= m - 1) {
+            size_t index = (pos + __builtin_ctz(m)) & mask;
+            _table_entry_t* entry = &tab->entries[index];
+            if(entry->hash == hash && (tab->atom_keys? entry->key == key: !strcmp(key, entry->key)))
+                return index;
+        }
+
+        if(match_byte(group, CTRL_EMPTY) != 0)
+            return -1;
+        pos = (pos + step) & mask;
+    }
+}
+
+/*
+ * Return the first slot that is empty or deleted on the probe for the hash.
+ * There always is one, because the table is never full.
+ */
+static size_t find_free(int8_t* ctrl, size_t capacity, uint32_t hash) {
+
+    size_t mask = capacity - 1;
+    size_t pos = H1(hash) & mask;
+
+    for(size_t step = GROUP_SIZE; ; step += GROUP_SIZE) {
+        uint32_t m = match_free(&ctrl[pos]);
+        if(m != 0)
+            return (pos + __builtin_ctz(m)) & mask;
+        pos = (pos + step) & mask;
+    }
+}
+
+static void alloc_slots(swiss_table_t* tab, size_t capacity) {
+
+    tab->capacity = capacity;
+    tab->ctrl = MALLOC(capacity + GROUP_SIZE);
+    memset(tab->ctrl, (uint8_t)CTRL_EMPTY, capacity + GROUP_SIZE);
+    tab->entries = CALLOC(capacity, sizeof(_table_entry_t));
+    if(tab->ctrl == NULL || tab->entries == NULL)
+        fatal_error("cannot allocate %lu slots for hash table", capacity);
+}
+
+/*
+ * Make room for one more entry. The table is kept no more than 7/8 full,
+ * counting the deleted slots, since probes go past them. If most of that is
+ * deleted slots, the table is rebuilt at the same size instead of growing.
+ * The entries keep their hashes, so nothing is hashed again.
+ */
+static void grow_table(swiss_table_t* tab) {
+
+    if((tab->count + tab->deleted + 1) * 8 <= tab->capacity * 7)
+        return;
+
+    size_t old_cap = tab->capacity;
+    int8_t* old_ctrl = tab->ctrl;
+    _table_entry_t* old = tab->entries;
+
+    size_t capacity = old_cap;
+    if((tab->count + 1) * 16 > capacity * 7)
+        capacity <<= 1;
+
+    alloc_slots(tab, capacity);
+    for(size_t i = 0; i < old_cap; i++) {
+        if(IS_FULL(old_ctrl[i])) {
+            size_t index = find_free(tab->ctrl, capacity, old[i].hash);
+            set_ctrl(tab, index, H2(old[i].hash));
+            tab->entries[index] = old[i];
+        }
+    }
+    tab->deleted = 0;
+
+    FREE(old_ctrl);
+    FREE(old);
+}
+
+swiss_table_t* create_swiss_table(void) {
+
+    swiss_table_t* tab = MALLOC(sizeof(swiss_table_t));
+    if(tab == NULL)
+        fatal_error("cannot allocate %lu bytes for hash table structure", sizeof(swiss_table_t));
+
+    tab->count = 0;
+    tab->deleted = 0;
+    tab->iter = 0;
+    tab->atom_keys = 0;
+    alloc_slots(tab, GROUP_SIZE);
+    return tab;
+}
+
+/*
+ * A table whose keys are atoms. They are not copied and are compared by
+ * their pointers, so every key given to the table has to be an atom.
+ */
+swiss_table_t* create_atom_swiss_table(void) {
+
+    swiss_table_t* tab = create_swiss_table();
+    tab->atom_keys = 1;
+    return tab;
+}
+
+static void free_entry(swiss_table_t* tab, _table_entry_t* entry) {
+
+    if(!tab->atom_keys)
+        FREE((void*)entry->key);
+    if(entry->size > HASH_INLINE_SIZE)
+        FREE(entry->value.data);
+}
+
+void destroy_swiss_table(swiss_table_t* tab) {
+
+    if(tab != NULL) {
+        for(size_t i = 0; i < tab->capacity; i++)
+            if(IS_FULL(tab->ctrl[i]))
+                free_entry(tab, &tab->entries[i]);
+        FREE(tab->ctrl);
+        FREE(tab->entries);
+        FREE(tab);
+    }
+}
+
+/*
+ * Refuse to replace an entry.
+ */
+int insert_swiss_table(swiss_table_t* tab, const char* key, void* data, size_t size) {
+
+    uint32_t hash = key_hash(tab, key);
+
+    if(find_slot(tab, key, hash) >= 0)
+        return HASH_EXIST;
+
+    if(size >= UINT32_MAX)
+        fatal_error("cannot keep %lu bytes of hash table data", size);
+
+    grow_table(tab);
+
+    size_t index = find_free(tab->ctrl, tab->capacity, hash);
+    if(tab->ctrl[index] == CTRL_DELETED)
+        tab->deleted--;
+    set_ctrl(tab, index, H2(hash));
+
+    _table_entry_t* entry = &tab->entries[index];
+    entry->hash = hash;
+    entry->key = tab->atom_keys? key: STRDUP(key);
+    entry->size = size;
+    if(size > HASH_INLINE_SIZE)
+        entry->value.data = MALLOC(size);
+    if(size > 0)
+        memcpy(entry_data(entry), data, size);
+    tab->count++;
+
+    return HASH_NO_ERROR;
+}
+
+int find_swiss_table(swiss_table_t* tab, const char* key, void* data, size_t size) {
+
+    ssize_t index = find_slot(tab, key, key_hash(tab, key));
+
+    if(index < 0)
+        return HASH_NOT_FOUND;
+
+    _table_entry_t* entry = &tab->entries[index];
+    if(data != NULL)
+        memcpy(data, entry_data(entry), (size < entry->size)? size: entry->size);
+    return HASH_NO_ERROR;
+}
+
+/*
+ * Take an entry out of the table and free its key and data. If the group has
+ * an empty slot, no probe ever went past this one, so it can be empty too.
+ * Otherwise it is marked deleted so that probes keep going.
+ */
+int remove_swiss_table(swiss_table_t* tab, const char* key) {
+
+    ssize_t index = find_slot(tab, key, key_hash(tab, key));
+
+    if(index < 0)
+        return HASH_NOT_FOUND;
+
+    free_entry(tab, &tab->entries[index]);
+    memset(&tab->entries[index], 0, sizeof(_table_entry_t));
+
+    // the group that ends at this slot and the one that starts at it
+    size_t mask = tab->capacity - 1;
+    size_t before = (index - GROUP_SIZE) & mask;
+    uint32_t empty_after = match_byte(&tab->ctrl[index], CTRL_EMPTY);
+    uint32_t empty_before = match_byte(&tab->ctrl[before], CTRL_EMPTY);
+    int never_full = empty_before && empty_after &&
+            (__builtin_ctz(empty_after) + __builtin_clz(empty_before << 16)) < GROUP_SIZE;
+
+    if(never_full)
+        set_ctrl(tab, index, CTRL_EMPTY);
+    else {
+        set_ctrl(tab, index, CTRL_DELETED);
+        tab->deleted++;
+    }
+    tab->count--;
+
+    return HASH_NO_ERROR;
+}
+
+size_t find_swiss_table_entry_size(swiss_table_t* tab, const char* key) {
+
+    ssize_t index = find_slot(tab, key, key_hash(tab, key));
+    return (index < 0)? 0: tab->entries[index].size;
+}
+
+/*
+ * Iterate all of the keys in the table. Make reset != 0 to start from the
+ * beginning of the table.
+ */
+const char* iterate_swiss_table(swiss_table_t* tab, int reset) {
+
+    if(reset)
+        tab->iter = 0;
+
+    while(tab->iter < tab->capacity) {
+        size_t i = tab->iter++;
+        if(IS_FULL(tab->ctrl[i]))
+            return tab->entries[i].key;
+    }
+    return NULL;
+}
+
+/*
+ * Move the cursor to the next entry. Returns 1 if there is one, or 0 when the
+ * walk is finished.
+ */
+int next_swiss_entry(swiss_table_t* tab, hash_cursor_t* cur) {
+
+    while(cur->index < tab->capacity) {
+        size_t i = cur->index++;
+        if(IS_FULL(tab->ctrl[i])) {
+            cur->key = tab->entries[i].key;
+            cur->data = entry_data(&tab->entries[i]);
+            cur->size = tab->entries[i].size;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Compare the linear probed hash table with the swiss table.
+ *
+ * Each table is filled with names like the globals of a large generated
+ * module, and then every name is looked up, and as many names that are not
+ * there. The sizes are picked so that the tables are measured both just
+ * before they would grow, where the linear table is 3/4 full, and at the
+ * 7/8 that the swiss table goes to. The fastest of the repeats is shown, in
+ * nanoseconds for each operation.
+ *
+ * use as:
+ * bench_hash -m 1000000 -r 5
+ *
+ * build as:
+ * gcc -Wall -Wextra -O2 bench_hash.c -I../src/include -L../lib -lutils -lpthread
+ */
+#include <time.h>
+
+#include "common.h"
+
+// there are no input files, so the options are not read with configure()
+BEGIN_CONFIG
+END_CONFIG
+
+memory_system_t* memory_system;
+
+typedef struct {
+    double insert;
+    double hit;
+    double miss;
+    double load;
+} bench_result_t;
+
+static double now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char** make_names(size_t num, const char* prefix) {
+
+    char buffer[64];
+    char** names = MALLOC(num * sizeof(char*));
+
+    for(size_t i = 0; i < num; i++) {
+        snprintf(buffer, sizeof(buffer), "%s_%zu", prefix, i * 7919);
+        names[i] = STRDUP(buffer);
+    }
+    return names;
+}
+
+static void free_names(char** names, size_t num) {
+
+    for(size_t i = 0; i < num; i++)
+        FREE(names[i]);
+    FREE(names);
+}
+
+/*
+ * The two tables have the same calls with different names, so the same
+ * measurement is written for each of them.
+ */
+#define MEASURE(res, tab, create_f, insert_f, find_f, destroy_f, cap) do {     \
+        size_t found = 0;                                                      \
+        int val;                                                               \
+        double start = now();                                                  \
+        tab = create_f();                                                      \
+        for(size_t i = 0; i < num; i++)                                        \
+            insert_f(tab, names[i], &i, sizeof(int));                          \
+        res.insert = (now() - start) * 1e9 / num;                              \
+        start = now();                                                         \
+        for(size_t i = 0; i < num; i++)                                        \
+            found += find_f(tab, names[i], &val, sizeof(val)) == HASH_NO_ERROR;\
+        res.hit = (now() - start) * 1e9 / num;                                 \
+        start = now();                                                         \
+        for(size_t i = 0; i < num; i++)                                        \
+            found += find_f(tab, missing[i], &val, sizeof(val)) == HASH_NO_ERROR;\
+        res.miss = (now() - start) * 1e9 / num;                                \
+        res.load = (double)num / (cap);                                        \
+        if(found != num)                                                       \
+            fatal_error("found %zu of %zu keys", found, num);                  \
+        destroy_f(tab);                                                        \
+    } while(0)
+
+static void keep_best(bench_result_t* best, bench_result_t* res, int first) {
+
+    if(first || res->insert < best->insert)
+        best->insert = res->insert;
+    if(first || res->hit < best->hit)
+        best->hit = res->hit;
+    if(first || res->miss < best->miss)
+        best->miss = res->miss;
+    best->load = res->load;
+}
+
+static void bench_size(size_t num, int repeat) {
+
+    char** names = make_names(num, "global");
+    char** missing = make_names(num, "absent");
+    bench_result_t lin, sw, res;
+    hash_table_t* htab;
+    swiss_table_t* stab;
+
+    for(int r = 0; r < repeat; r++) {
+        MEASURE(res, htab, create_hash_table, insert_hash_table, find_hash_table,
+                destroy_hash_table, htab->capacity);
+        keep_best(&lin, &res, r == 0);
+        MEASURE(res, stab, create_swiss_table, insert_swiss_table, find_swiss_table,
+                destroy_swiss_table, stab->capacity);
+        keep_best(&sw, &res, r == 0);
+    }
+
+    printf("%10zu %-7s %6.2f %10.1f %10.1f %10.1f\n", num, "linear", lin.load, lin.insert, lin.hit, lin.miss);
+    printf("%10s %-7s %6.2f %10.1f %10.1f %10.1f\n", "", "swiss", sw.load, sw.insert, sw.hit, sw.miss);
+
+    free_names(names, num);
+    free_names(missing, num);
+}
+
+int main(int argc, char** argv) {
+
+    size_t max = 1000000;
+    int repeat = 5;
+    int c;
+
+    while((c = getopt(argc, argv, "m:r:h")) != -1) {
+        switch(c) {
+            case 'm': max = strtoul(optarg, NULL, 0); break;
+            case 'r': repeat = atoi(optarg); break;
+            default:
+                fprintf(stderr, "use: bench_hash [-m most keys] [-r repeats]\n");
+                return 1;
+        }
+    }
+    if(repeat < 1)
+        repeat = 1;
+
+    init_memory_system();
+    init_errors(0, stdout);
+
+    printf("%10s %-7s %6s %10s %10s %10s\n", "keys", "table", "load", "insert ns", "hit ns", "miss ns");
+
+    // just under where each table grows, for every size up to the most
+    for(size_t cap = 1024; cap * 7 / 8 <= max; cap *= 4) {
+        bench_size(cap * 3 / 4 - 2, repeat);
+        bench_size(cap * 7 / 8 - 1, repeat);
+    }
+
+    int errors = get_num_errors();
+    destroy_memory_system();
+
+    return errors;
+}
@@ -0,0 +1,133 @@
+/*
+ * Measure how fast the scanner is.
+ *
+ * Every module that is named is scanned with get_token() from start to end,
+ * and the modules that it imports are opened the same way that the parser
+ * opens them. Each module is scanned more than once and the fastest time is
+ * the one that is shown. Use gen_corpus to make modules to scan.
+ *
+ * use as:
+ * bench_scanner -p corpus -s fast -r 5 small medium large
+ *
+ * build as:
+ * gcc -Wall -Wextra -O2 bench_scanner.c -I../src/include -I../src/parse -L../lib -lparser -lsupport -lutils -lpthread -lm
+ */
+#include <sys/stat.h>
+#include <time.h>
+
+#include "common.h"
+#include "internal.h"
+
+BEGIN_CONFIG
+    CONFIG_NUM("-v", "VERBOSE", "Set the verbosity from 0 to 50", 0, 0)
+    CONFIG_LIST("-p", "FPATH", "Specify directories to search for imports", 0, ".")
+    CONFIG_BOOL("-m", "NO_MMAP", "Read source files into memory instead of mapping them", 0, 0)
+    CONFIG_STR("-c", "TOKEN_CACHE", "Keep the tokens of scanned files in this directory", 0, NULL)
+    CONFIG_STR("-s", "SCANNER", "Select the scanner: flex, fast, or diff to run both and compare", 0, "flex")
+    CONFIG_NUM("-r", "REPEAT", "Scan each module this many times and keep the fastest", 0, 5)
+END_CONFIG
+
+memory_system_t* memory_system;
+
+typedef struct {
+    size_t bytes;
+    size_t tokens;
+    double seconds;
+} bench_result_t;
+
+static double now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t file_size(const char* module) {
+
+    struct stat st;
+    char* path = find_import_file(module);
+    size_t size = 0;
+
+    if(path != NULL && !stat(path, &st))
+        size = st.st_size;
+    FREE(path);
+    return size;
+}
+
+/*
+ * Scan a module and everything that it imports. An import is opened after
+ * its ';' is taken, just like parse_import() does.
+ */
+static bench_result_t scan_module(const char* module) {
+
+    bench_result_t res = {0, 0, 0.0};
+    scanner_t* scan = create_scanner();
+    scanner_t* prev = set_error_scanner(scan);
+    token_slice_t tok;
+    char name[256];
+
+    // finding the size of a file is not part of the time
+    res.bytes = file_size(module);
+    double start = now();
+    open_file(scan, module);
+
+    do {
+        tok = get_token(scan);
+        res.tokens++;
+
+        if(tok.kind == IMPORT) {
+            tok = get_token(scan);
+            res.tokens++;
+            if(tok.kind != STRING_LITERAL)
+                continue;
+
+            snprintf(name, sizeof(name), "%.*s", (int)tok.value.str.len, tok.value.str.ptr);
+            tok = get_token(scan);
+            res.tokens++;
+            if(tok.kind == ';') {
+                double pause = now();
+                res.bytes += file_size(name);
+                start += now() - pause;
+                open_file(scan, name);
+            }
+        }
+    } while(tok.kind != END_OF_INPUT);
+
+    res.seconds = now() - start;
+
+    set_error_scanner(prev);
+    destroy_scanner(scan);
+    return res;
+}
+
+int main(int argc, char** argv) {
+
+    init_memory_system();
+    configure(argc, argv);
+    init_errors(GET_CONFIG_NUM("VERBOSE"), stdout);
+
+    int repeat = GET_CONFIG_NUM("REPEAT");
+    if(repeat < 1)
+        repeat = 1;
+
+    printf("scanner: %s\n", GET_CONFIG_STR("SCANNER"));
+    printf("%-16s %12s %12s %10s %12s %10s\n", "module", "bytes", "tokens", "ms", "Mtokens/s", "MB/s");
+
+    for(char* str = iterate_config("INFILES"); str != NULL; str = iterate_config("INFILES")) {
+        bench_result_t best = {0, 0, 0.0};
+        for(int i = 0; i < repeat; i++) {
+            bench_result_t res = scan_module(str);
+            if(i == 0 || res.seconds < best.seconds)
+                best = res;
+        }
+
+        double secs = (best.seconds > 0.0)? best.seconds: 1e-9;
+        printf("%-16s %12zu %12zu %10.3f %12.2f %10.1f\n", str, best.bytes, best.tokens,
+                best.seconds * 1e3, best.tokens / secs / 1e6, best.bytes / secs / (1024.0 * 1024.0));
+    }
+
+    int errors = get_num_errors();
+    destroy_memory_system();
+
+    return errors;
+}
@@ -0,0 +1,211 @@
+/*
+ * Measure the symbol table with more than one thread adding to it.
+ *
+ * Each thread stands for a module. It adds its own names and a set of names
+ * that every module has, which only one of the threads gets to add, and then
+ * looks up the names of the next module. The total number of names is the
+ * same for every number of threads, so a table that does not make the threads
+ * wait for each other takes less time with more threads. The same work is
+ * done with one hash table behind one lock to compare with. The fastest of
+ * the repeats is shown.
+ *
+ * use as:
+ * bench_symbols -n 1000000 -r 5
+ *
+ * build as:
+ * gcc -Wall -Wextra -O2 bench_symbols.c -I../src/include -L../lib -lsupport -lutils -lpthread
+ */
+#include <pthread.h>
+#include <time.h>
+
+#include "common.h"
+
+// there are no input files, so the options are not read with configure()
+BEGIN_CONFIG
+END_CONFIG
+
+memory_system_t* memory_system;
+
+#define MAX_THREADS 16
+#define NUM_SHARED 1000
+
+typedef struct {
+    atom_t* names;          // the names of this module
+    atom_t* others;         // the names of the next one
+    size_t num;
+    size_t added;           // how many of the shared names this thread added
+    size_t found;
+} worker_t;
+
+static atom_t shared[NUM_SHARED];
+static ast_node_t node;
+static ast_node_t* node_ptr = &node;
+static pthread_barrier_t barrier;
+
+// the table for this run, one of the two
+static symbol_table_t table;
+static hash_table_t* one_table;
+static pthread_mutex_t one_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static double now(void) {
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int add_one(atom_t name) {
+
+    pthread_mutex_lock(&one_lock);
+    int retv = insert_hash_table(one_table, name, &node_ptr, sizeof(ast_node_t*));
+    pthread_mutex_unlock(&one_lock);
+    return (retv == HASH_NO_ERROR)? ST_NO_ERROR: ST_SYMBOL_EXISTS;
+}
+
+static int find_one(atom_t name) {
+
+    pthread_mutex_lock(&one_lock);
+    int retv = find_hash_table(one_table, name, NULL, 0);
+    pthread_mutex_unlock(&one_lock);
+    return (retv == HASH_NO_ERROR)? ST_NO_ERROR: ST_NOT_FOUND;
+}
+
+static void* work(void* arg) {
+
+    worker_t* w = arg;
+
+    pthread_barrier_wait(&barrier);
+
+    for(size_t i = 0; i < w->num; i++) {
+        int retv = (table != NULL)? add_atom_symbol(table, w->names[i], &node): add_one(w->names[i]);
+        if(retv != ST_NO_ERROR)
+            fatal_error("cannot add %s", w->names[i]);
+        if(i < NUM_SHARED) {
+            retv = (table != NULL)? add_atom_symbol(table, shared[i], &node): add_one(shared[i]);
+            w->added += retv == ST_NO_ERROR;
+        }
+    }
+
+    pthread_barrier_wait(&barrier);
+
+    // the next module may not be done, so not every name is there yet
+    for(size_t i = 0; i < w->num; i++)
+        w->found += ((table != NULL)? peek_atom_symbol(table, w->others[i]): find_one(w->others[i])) == ST_NO_ERROR;
+
+    pthread_barrier_wait(&barrier);
+    return NULL;
+}
+
+/*
+ * Run the threads once and return the time it took.
+ */
+static double run(atom_t* names, size_t total, int num_threads, int striped) {
+
+    pthread_t threads[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    size_t per = total / num_threads;
+
+    if(striped)
+        table = create_symbol_table();
+    else {
+        table = NULL;
+        one_table = create_atom_hash_table();
+    }
+
+    pthread_barrier_init(&barrier, NULL, num_threads + 1);
+    for(int i = 0; i < num_threads; i++) {
+        workers[i].names = &names[i * per];
+        workers[i].others = &names[((i + 1) % num_threads) * per];
+        workers[i].num = per;
+        workers[i].added = 0;
+        workers[i].found = 0;
+        pthread_create(&threads[i], NULL, work, &workers[i]);
+    }
+
+    pthread_barrier_wait(&barrier);
+    double start = now();
+    pthread_barrier_wait(&barrier);
+    pthread_barrier_wait(&barrier);
+    double time = now() - start;
+
+    size_t added = 0;
+    for(int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        added += workers[i].added;
+    }
+    pthread_barrier_destroy(&barrier);
+
+    size_t count = striped? num_symbols(table): one_table->count;
+    size_t want = per * num_threads + ((per < NUM_SHARED)? per: NUM_SHARED);
+    if(count != want || added != ((per < NUM_SHARED)? per: NUM_SHARED))
+        fatal_error("the table has %zu names and added %zu shared ones", count, added);
+
+    if(striped)
+        destroy_symbol_table(table);
+    else
+        destroy_hash_table(one_table);
+
+    return time;
+}
+
+int main(int argc, char** argv) {
+
+    size_t total = 1000000;
+    int repeat = 5;
+    int c;
+
+    while((c = getopt(argc, argv, "n:r:h")) != -1) {
+        switch(c) {
+            case 'n': total = strtoul(optarg, NULL, 0); break;
+            case 'r': repeat = atoi(optarg); break;
+            default:
+                fprintf(stderr, "use: bench_symbols [-n names] [-r repeats]\n");
+                return 1;
+        }
+    }
+    if(repeat < 1)
+        repeat = 1;
+    if(total < MAX_THREADS)
+        total = MAX_THREADS;
+
+    init_memory_system();
+    init_errors(0, stdout);
+
+    // the atoms are made first, so only the table is measured
+    char buffer[64];
+    atom_t* names = MALLOC(total * sizeof(atom_t));
+    for(size_t i = 0; i < total; i++) {
+        snprintf(buffer, sizeof(buffer), "module_%zu.global_%zu", i % MAX_THREADS, i * 7919);
+        names[i] = intern_string(buffer);
+    }
+    for(int i = 0; i < NUM_SHARED; i++) {
+        snprintf(buffer, sizeof(buffer), "shared_%d", i);
+        shared[i] = intern_string(buffer);
+    }
+
+    printf("%8s %14s %14s %14s %14s\n", "threads", "striped ms", "striped Mop/s", "one lock ms", "one lock Mop/s");
+
+    for(int num_threads = 1; num_threads <= MAX_THREADS; num_threads *= 2) {
+        double striped = 0, one = 0;
+        for(int r = 0; r < repeat; r++) {
+            double t = run(names, total, num_threads, 1);
+            if(r == 0 || t < striped)
+                striped = t;
+            t = run(names, total, num_threads, 0);
+            if(r == 0 || t < one)
+                one = t;
+        }
+        // an add and a look up for each name
+        double ops = 2.0 * (total / num_threads) * num_threads;
+        printf("%8d %14.1f %14.1f %14.1f %14.1f\n", num_threads,
+                striped * 1e3, ops / striped * 1e-6, one * 1e3, ops / one * 1e-6);
+    }
+
+    FREE(names);
+    destroy_atoms();
+
+    int errors = get_num_errors();
+    destroy_memory_system();
+
+    return errors;
+}
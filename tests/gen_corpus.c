@@ -0,0 +1,318 @@
+/*
+ * Write Simple source files to measure the scanner with.
+ *
+ * The text looks like a Simple module: imports, data definitions, and
+ * functions with statements in them. How often the operands of the
+ * statements are identifiers, numbers, or strings, and how often comments
+ * appear, is set with -m. With -d, the module imports other modules that are
+ * written next to it, and those import more, to the given depth.
+ *
+ * use as:
+ * gen_corpus -o dir -n name -s 1M -m 40,30,15,15 -d 2 -f 3
+ *
+ * build as:
+ * gcc -Wall -Wextra -O2 gen_corpus.c -o gen_corpus
+ */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    const char* dir;
+    const char* name;
+    size_t size;        // of each file, in bytes
+    int mix[4];         // weights of identifiers, numbers, strings, comments
+    int depth;          // how deeply the imports are nested
+    int fanout;         // how many modules each module imports
+    uint64_t seed;
+} options_t;
+
+enum { MIX_IDENT, MIX_NUMBER, MIX_STRING, MIX_COMMENT };
+
+static const char* types[] = { "int", "uint", "float", "bool", "string" };
+static const char* binops[] = { "+", "-", "*", "/", "%", "<<", ">>", "&", "|", "^",
+                                "<", ">", "<=", ">=", "==", "!=", "&&", "||" };
+static const char* words[] = { "count", "index", "value", "name", "total", "left",
+                               "right", "buffer", "size", "next", "prev", "node",
+                               "table", "entry", "result", "offset", "length", "item" };
+
+#define NUM(a) (sizeof(a) / sizeof((a)[0]))
+
+static uint64_t rand_state;
+
+// xorshift, so that the same seed always makes the same files
+static uint64_t next_rand(void) {
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+    return rand_state;
+}
+
+static int pick(int n) { return (int)(next_rand() % (uint64_t)n); }
+
+// pick an index, where each one is as likely as its weight
+static int pick_weighted(const int* w, int n) {
+
+    int total = 0;
+    for(int i = 0; i < n; i++)
+        total += w[i];
+    if(total == 0)
+        return 0;
+
+    int r = pick(total);
+    for(int i = 0; i < n; i++) {
+        if(r < w[i])
+            return i;
+        r -= w[i];
+    }
+    return n - 1;
+}
+
+static void put_ident(FILE* fp) {
+
+    fprintf(fp, "%s", words[pick(NUM(words))]);
+    if(pick(3))
+        fprintf(fp, "_%d", pick(1000));
+}
+
+static void put_number(FILE* fp) {
+
+    switch(pick(4)) {
+        case 0:
+            fprintf(fp, "%d", pick(100));
+            break;
+        case 1:
+            fprintf(fp, "%u", (unsigned)next_rand());
+            break;
+        case 2:
+            fprintf(fp, "0x%llX", (unsigned long long)next_rand() >> pick(60));
+            break;
+        default:
+            fprintf(fp, "%.*f", 1 + pick(8), (double)pick(1000000) / (1 + pick(1000)));
+            break;
+    }
+}
+
+static void put_string(FILE* fp) {
+
+    int len = 4 + pick(40);
+    fputc('"', fp);
+    for(int i = 0; i < len; i++) {
+        int r = pick(40);
+        if(r == 0)
+            fputs("\\n", fp);
+        else if(r == 1)
+            fputs("\\\"", fp);
+        else if(r < 8)
+            fputc(' ', fp);
+        else
+            fputc('a' + pick(26), fp);
+    }
+    fputc('"', fp);
+}
+
+static void put_comment(FILE* fp, const char* indent) {
+
+    int len = 10 + pick(60);
+    if(pick(2)) {
+        fprintf(fp, "%s// ", indent);
+        for(int i = 0; i < len; i++)
+            fputc(pick(6)? 'a' + pick(26): ' ', fp);
+        fputc('\n', fp);
+    }
+    else {
+        fprintf(fp, "%s/*\n%s * ", indent, indent);
+        for(int i = 0; i < len; i++) {
+            if(i % 30 == 29)
+                fprintf(fp, "\n%s * ", indent);
+            else
+                fputc(pick(6)? 'a' + pick(26): ' ', fp);
+        }
+        fprintf(fp, "\n%s */\n", indent);
+    }
+}
+
+static void put_operand(FILE* fp, const options_t* opt) {
+
+    // comments are not operands
+    switch(pick_weighted(opt->mix, MIX_COMMENT)) {
+        case MIX_IDENT:
+            put_ident(fp);
+            break;
+        case MIX_NUMBER:
+            put_number(fp);
+            break;
+        default:
+            put_string(fp);
+            break;
+    }
+}
+
+static void put_expression(FILE* fp, const options_t* opt) {
+
+    int terms = 1 + pick(5);
+    for(int i = 0; i < terms; i++) {
+        if(i > 0)
+            fprintf(fp, " %s ", binops[pick(NUM(binops))]);
+        if(pick(8) == 0) {
+            fputc('(', fp);
+            put_operand(fp, opt);
+            fprintf(fp, " %s ", binops[pick(NUM(binops))]);
+            put_operand(fp, opt);
+            fputc(')', fp);
+        }
+        else
+            put_operand(fp, opt);
+    }
+}
+
+// comments take the place of a statement as often as their weight says
+static int want_comment(const options_t* opt) {
+    return pick_weighted(opt->mix, 4) == MIX_COMMENT;
+}
+
+static void put_function(FILE* fp, const options_t* opt) {
+
+    fprintf(fp, "%s ", types[pick(NUM(types))]);
+    put_ident(fp);
+    fputc('(', fp);
+    int parms = pick(4);
+    for(int i = 0; i < parms; i++) {
+        fprintf(fp, "%s%s ", i? ", ": "", types[pick(NUM(types))]);
+        put_ident(fp);
+    }
+    fprintf(fp, ") {\n");
+
+    int stmts = 2 + pick(10);
+    for(int i = 0; i < stmts; i++) {
+        if(want_comment(opt)) {
+            put_comment(fp, "    ");
+            continue;
+        }
+        switch(pick(4)) {
+            case 0:
+                fprintf(fp, "    %s ", types[pick(NUM(types))]);
+                put_ident(fp);
+                fprintf(fp, " = ");
+                break;
+            case 1:
+                fprintf(fp, "    if(");
+                put_expression(fp, opt);
+                fprintf(fp, ")\n        ");
+                put_ident(fp);
+                fprintf(fp, " = ");
+                break;
+            default:
+                fprintf(fp, "    ");
+                put_ident(fp);
+                fprintf(fp, " = ");
+                break;
+        }
+        put_expression(fp, opt);
+        fprintf(fp, ";\n");
+    }
+    fprintf(fp, "    return ");
+    put_expression(fp, opt);
+    fprintf(fp, ";\n}\n\n");
+}
+
+static void write_module(const options_t* opt, const char* name, int level) {
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s.s", opt->dir, name);
+
+    FILE* fp = fopen(path, "w");
+    if(fp == NULL) {
+        fprintf(stderr, "gen_corpus: cannot open \"%s\": %s\n", path, strerror(errno));
+        exit(1);
+    }
+
+    if(level < opt->depth) {
+        for(int i = 1; i <= opt->fanout; i++) {
+            char sub[1024];
+            snprintf(sub, sizeof(sub), "%s_%d", name, i);
+            fprintf(fp, "import \"%s\";\n", sub);
+            write_module(opt, sub, level + 1);
+        }
+        fputc('\n', fp);
+    }
+
+    while((size_t)ftell(fp) < opt->size) {
+        if(want_comment(opt))
+            put_comment(fp, "");
+        else if(pick(3) == 0) {
+            fprintf(fp, "%s %s", types[pick(NUM(types))], pick(4)? "": "*");
+            put_ident(fp);
+            fprintf(fp, ";\n");
+        }
+        else
+            put_function(fp, opt);
+    }
+
+    fclose(fp);
+}
+
+static size_t get_size(const char* str) {
+
+    char* end;
+    size_t size = strtoul(str, &end, 10);
+    switch(*end) {
+        case 'k': case 'K': size <<= 10; break;
+        case 'm': case 'M': size <<= 20; break;
+        case 'g': case 'G': size <<= 30; break;
+    }
+    return size;
+}
+
+static void show_use(void) {
+
+    fprintf(stderr,
+        "use: gen_corpus [options]\n"
+        "  -o dir      where to write the files (.)\n"
+        "  -n name     name of the top module (corpus)\n"
+        "  -s size     size of each file, with K, M, or G (64K)\n"
+        "  -m i,n,s,c  weights of identifiers, numbers, strings, and comments (40,30,15,15)\n"
+        "  -d depth    how deeply the imports are nested (0)\n"
+        "  -f fanout   how many modules each module imports (1)\n"
+        "  -r seed     seed for the random numbers (1)\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+
+    options_t opt = {
+        .dir = ".",
+        .name = "corpus",
+        .size = 64 * 1024,
+        .mix = { 40, 30, 15, 15 },
+        .depth = 0,
+        .fanout = 1,
+        .seed = 1,
+    };
+    int c;
+
+    while((c = getopt(argc, argv, "o:n:s:m:d:f:r:h")) != -1) {
+        switch(c) {
+            case 'o': opt.dir = optarg; break;
+            case 'n': opt.name = optarg; break;
+            case 's': opt.size = get_size(optarg); break;
+            case 'm':
+                if(4 != sscanf(optarg, "%d,%d,%d,%d", &opt.mix[0], &opt.mix[1], &opt.mix[2], &opt.mix[3]))
+                    show_use();
+                break;
+            case 'd': opt.depth = atoi(optarg); break;
+            case 'f': opt.fanout = atoi(optarg); break;
+            case 'r': opt.seed = strtoull(optarg, NULL, 0); break;
+            default: show_use();
+        }
+    }
+
+    // xorshift is stuck at zero
+    rand_state = opt.seed? opt.seed: 1;
+    write_module(&opt, opt.name, 0);
+
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * Simple regression test for the arena allocator.
+ *
+ * build as:
+ * gcc -Wall -Wextra -g test_arena.c -I../src/include -L../lib -lutils
+ */
+
+#include "common.h"
+
+#ifdef _ARENA_QUARANTINE
+/*
+ * Retire an arena that a watched table points into. This is run in a
+ * process of its own, because it is expected to stop with a fatal error.
+ */
+static void retire_stale(void)
+{
+    arena_t* arena = create_arena(1024);
+    char* stale = arena_strndup(arena, "stale", 5);
+    hash_table_t* tab = create_atom_hash_table();
+    watch_hash_table(tab, NULL);
+    insert_hash_table(tab, intern_string("stale"), &stale, sizeof(stale));
+    retire_arena(arena);
+    exit(0);
+}
+#endif
+
+int main(int argc, char** argv)
+{
+#ifdef _ARENA_QUARANTINE
+    if(argc > 1 && !strcmp(argv[1], "stale"))
+        retire_stale();
+#else
+    (void)argc;
+    (void)argv;
+#endif
+
+    arena_t* arena = create_arena(1024);
+    int errors = 0;
+
+    printf("\nallocate small items\n");
+    char* strs[100];
+    for(int i = 0; i < 100; i++) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "string number %d", i);
+        strs[i] = arena_strndup(arena, buf, strlen(buf));
+        if(((uintptr_t)strs[i] & 7) != 0) {
+            printf("not aligned: %p\n", strs[i]);
+            errors++;
+        }
+    }
+    for(int i = 0; i < 100; i++) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "string number %d", i);
+        if(strcmp(buf, strs[i])) {
+            printf("overwritten: %s != %s\n", buf, strs[i]);
+            errors++;
+        }
+    }
+
+    printf("\ngrow the last item in place\n");
+    char* ptr = arena_alloc(arena, 16);
+    strcpy(ptr, "grow me");
+    char* grown = arena_grow(arena, ptr, 16, 64);
+    printf("%s: %s\n", grown == ptr? "in place": "copied", grown);
+    if(grown != ptr || strcmp(grown, "grow me"))
+        errors++;
+
+    printf("\ngrow an item that is not the last one\n");
+    char* other = arena_alloc(arena, 16);
+    strcpy(other, "other");
+    grown = arena_grow(arena, ptr, 64, 128);
+    printf("%s: %s\n", grown == ptr? "in place": "copied", grown);
+    if(grown == ptr || strcmp(grown, "grow me") || strcmp(other, "other"))
+        errors++;
+
+    printf("\ngrow one item to much more than a block\n");
+    size_t cap = 8;
+    size_t len = 0;
+    char* big = arena_alloc(arena, cap);
+    for(int i = 0; i < 100000; i++) {
+        if(len + 1 >= cap) {
+            big = arena_grow(arena, big, len, cap * 2);
+            cap *= 2;
+        }
+        big[len++] = 'a' + (i % 26);
+    }
+    for(size_t i = 0; i < len; i++) {
+        if(big[i] != 'a' + (int)(i % 26)) {
+            printf("wrong character at %lu\n", i);
+            errors++;
+            break;
+        }
+    }
+    printf("length: %lu capacity: %lu\n", len, cap);
+
+    printf("\ndestroy the arena\n");
+    destroy_arena(arena);
+
+    printf("\nretire more arenas than the quarantine holds\n");
+    for(int i = 0; i < 10; i++) {
+        arena = create_arena(1024);
+        for(int j = 0; j < 100; j++)
+            arena_strndup(arena, "retired", 7);
+#ifdef _ARENA_QUARANTINE
+        // a pointer kept from before reads the pattern
+        char* kept = arena->blocks->data;
+        retire_arena(arena);
+        if(i == 9 && (unsigned char)kept[0] != 0xA5) {
+            printf("retired arena was not filled\n");
+            errors++;
+        }
+#else
+        retire_arena(arena);
+#endif
+    }
+    flush_quarantine();
+
+#ifdef _ARENA_QUARANTINE
+    printf("\nretire an arena that a watched table points into\n");
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "%s stale 2>/dev/null", argv[0]);
+    int status = system(cmd);
+    if(WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        printf("the stale pointer was not found\n");
+        errors++;
+    }
+#endif
+
+    printf("\n%s: %d errors\n", errors? "failed": "passed", errors);
+    return errors;
+}
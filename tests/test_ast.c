@@ -2,61 +2,203 @@
 #include "common.h"
 
 // build  as:
-// gcc -Wall -Wextra -g test_ast.c -I../src/include -L../lib/ -last -lutils -lparser
+// gcc -Wall -Wextra -g test_ast.c -I../src/include -L../lib/ -lsupport -lparser -lutils
+
+memory_system_t* memory_system;
+
+static ast_visit_result_t count_pre(ast_node_t* node, ast_node_t* parent, void* data) {
+
+    ((int*)data)[0]++;
+    return AST_VISIT_CONTINUE;
+}
+
+static ast_visit_result_t count_post(ast_node_t* node, ast_node_t* parent, void* data) {
+
+    ((int*)data)[1]++;
+    return AST_VISIT_CONTINUE;
+}
 
 int main(void) {
 
     char buffer[25];
-    int number;
+    int errors = 0;
+    ast_t* ast = create_ast();
     ast_node_t* root, *new_root;
 
-    root = create_node();
-    strcpy(buffer, "root");
-    add_attribute(root, "NAME", buffer, strlen(buffer)+1);
-    number = 1;
-    add_attribute(root, "LINE", &number, sizeof(number));
-    number = 1;
-    add_attribute(root, "COLUMN", &number, sizeof(number));
+    root = create_node(ast, ROOT_NODE);
+    set_node_str(root, NAME_ATTR, "root");
+    ast->root = root;
 
-    new_root = create_node();
-    add_node_as_child(root, new_root);
+    new_root = create_node(ast, DATA_DEF_NODE);
+    add_ast_node(ast, root, new_root);
     strcpy(buffer, "first_child");
-    add_attribute(new_root, "NAME", buffer, strlen(buffer)+1);
-    number = 2;
-    add_attribute(new_root, "LINE", &number, sizeof(number));
-    number = 3;
-    add_attribute(new_root, "COLUMN", &number, sizeof(number));
-
-    new_root = create_node();
-    add_node_as_child(root, new_root);
+    set_node_str(new_root, NAME_ATTR, ast_strndup(ast, buffer, strlen(buffer)));
+    set_node_num(new_root, DATA_TYPE_ATTR, INT);
+
+    new_root = create_node(ast, DATA_DEF_NODE);
+    add_ast_node(ast, root, new_root);
     strcpy(buffer, "second_child");
-    add_attribute(new_root, "NAME", buffer, strlen(buffer)+1);
-    number = 4;
-    add_attribute(new_root, "LINE", &number, sizeof(number));
-    number = 5;
-    add_attribute(new_root, "COLUMN", &number, sizeof(number));
-
-    new_root = create_node();
-    add_node_as_sibling(root, new_root);
-    strcpy(buffer, "first_sibling");
-    add_attribute(new_root, "NAME", buffer, strlen(buffer)+1);
-    number = 6;
-    add_attribute(new_root, "LINE", &number, sizeof(number));
-    number = 7;
-    add_attribute(new_root, "COLUMN", &number, sizeof(number));
-
-    new_root = create_node();
-    add_node_as_sibling(root, new_root);
-    strcpy(buffer, "second_sibling");
-    add_attribute(new_root, "NAME", buffer, strlen(buffer)+1);
-    number = 8;
-    add_attribute(new_root, "LINE", &number, sizeof(number));
-    number = 9;
-    add_attribute(new_root, "COLUMN", &number, sizeof(number));
+    set_node_str(new_root, NAME_ATTR, ast_strndup(ast, buffer, strlen(buffer)));
+    set_node_num(new_root, DATA_TYPE_ATTR, FLOAT);
+    set_node_num(new_root, IS_POINTER_ATTR, 2);
+
+    // enough children that the array has to grow
+    for(int i = 0; i < 100; i++) {
+        ast_node_t* n = create_node(ast, FUNC_PARAM_NODE);
+        snprintf(buffer, sizeof(buffer), "param_%d", i);
+        set_node_str(n, NAME_ATTR, ast_strndup(ast, buffer, strlen(buffer)));
+        add_ast_node(ast, new_root, n);
+    }
+
+    // the copy does not change with the buffer
+    strcpy(buffer, "changed");
+    if(strcmp(get_node_str(root->children[0], NAME_ATTR), "first_child")) {
+        printf("first child is named \"%s\"\n", get_node_str(root->children[0], NAME_ATTR));
+        errors++;
+    }
 
+    if(root->num_children != 2 || new_root->num_children != 100) {
+        printf("wrong number of children: %u %u\n", root->num_children, new_root->num_children);
+        errors++;
+    }
 
+    for(uint32_t i = 0; i < new_root->num_children; i++) {
+        snprintf(buffer, sizeof(buffer), "param_%u", i);
+        if(strcmp(get_node_str(new_root->children[i], NAME_ATTR), buffer)) {
+            printf("child %u is named \"%s\"\n", i, get_node_str(new_root->children[i], NAME_ATTR));
+            errors++;
+        }
+    }
+
+    if(ast->num_nodes != 103) {
+        printf("counted %zu nodes\n", ast->num_nodes);
+        errors++;
+    }
+
+    // the flat copy has the same nodes in pre-order
+    flat_ast_t* flat = flatten_ast(ast);
+    if(flat->count != 103 || flat->kind[0] != ROOT_NODE) {
+        printf("flat tree has %u nodes and the first is %d\n", flat->count, flat->kind[0]);
+        errors++;
+    }
+
+    ast_index_t first = flat->first_child[0];
+    ast_index_t second = flat->next_sibling[first];
+    if(strcmp(flat_node_name(flat, first), "first_child") ||
+            strcmp(flat_node_name(flat, second), "second_child") ||
+            flat_node_ptr_depth(flat, second) != 2 || flat->next_sibling[second] != NO_AST_INDEX) {
+        printf("flat children of the root are wrong\n");
+        errors++;
+    }
+
+    int count = 0;
+    for(ast_index_t i = flat->first_child[second]; i != NO_AST_INDEX; i = flat->next_sibling[i]) {
+        snprintf(buffer, sizeof(buffer), "param_%d", count++);
+        if(i <= second || strcmp(flat_node_name(flat, i), buffer)) {
+            printf("flat child %u is named \"%s\"\n", i, flat_node_name(flat, i));
+            errors++;
+        }
+    }
+    if(count != 100) {
+        printf("flat node has %d children\n", count);
+        errors++;
+    }
+
+    // a saved module maps back with the same nodes and can be put into a tree
+    flat_ast_t* module = flatten_module(root, 1);
+    if(save_flat_ast(module, "testfile.ast", 1234, 5678)) {
+        printf("cannot save the module\n");
+        errors++;
+    }
+    flat_ast_t* mapped = map_flat_ast("testfile.ast", 1234, 5678);
+    if(mapped == NULL || mapped->count != module->count ||
+            memcmp(mapped->next_sibling, module->next_sibling, module->count * sizeof(ast_index_t)) ||
+            map_flat_ast("testfile.ast", 1234, 5679) != NULL) {
+        printf("the mapped module is not the one that was saved\n");
+        errors++;
+    }
+    else {
+        ast_t* copy = create_ast();
+        copy->root = create_node(copy, ROOT_NODE);
+        graft_flat_ast(copy, copy->root, mapped, 1);
+        if(copy->num_nodes != ast->num_nodes || copy->root->num_children != 2 ||
+                strcmp(get_node_str(copy->root->children[1]->children[99], NAME_ATTR), "param_99")) {
+            printf("the module was not put back the same\n");
+            errors++;
+        }
+        destroy_ast(copy);
+    }
+    destroy_flat_ast(mapped);
+    destroy_flat_ast(module);
+    unlink("testfile.ast");
+
+    // two walks of the same tree do not get in the way of each other
+    ast_cursor_t c1, c2;
+    ast_node_t* n1, *n2;
+    init_ast_cursor(&c1, root);
+    init_ast_cursor(&c2, root);
+    count = 0;
+    while((n1 = next_ast_node(&c1)) != NULL) {
+        n2 = next_ast_node(&c2);
+        if(n1 != n2 || get_ast_depth(&c1) != get_ast_depth(&c2)) {
+            printf("the walks differ at node %d\n", count);
+            errors++;
+            break;
+        }
+        count++;
+    }
+    if(count != 103 || next_ast_node(&c2) != NULL) {
+        printf("the walk saw %d nodes\n", count);
+        errors++;
+    }
+    free_ast_cursor(&c1);
+    free_ast_cursor(&c2);
 
     dump_ast(root, "testfile.dot");
 
-    return 0;
+    // the names of an imported module are found by the module and the name
+    ast_node_t* import = create_node(ast, IMPORT_NODE);
+    ast_node_t* nested = create_node(ast, IMPORT_NODE);
+    ast_node_t* def = create_node(ast, DATA_DEF_NODE);
+    set_node_str(import, IMPORT_NAME_ATTR, intern_string("module"));
+    set_node_str(nested, IMPORT_NAME_ATTR, intern_string("nested"));
+    set_node_str(def, NAME_ATTR, intern_string("value"));
+    add_ast_node(ast, import, def);
+    add_ast_node(ast, import, nested);
+    add_exports(ast, import);
+    add_exports(ast, import);
+    if(find_export(ast, intern_string("module"), intern_string("value")) != def ||
+            find_export(ast, intern_string("module"), intern_string("nested")) != nested ||
+            find_export(ast, intern_string("module"), intern_string("other")) != NULL ||
+            find_export(ast, intern_string("nested"), intern_string("value")) != NULL ||
+            get_exports(ast, intern_string("module"))->count != 2) {
+        printf("the export table of the module is wrong\n");
+        errors++;
+    }
+
+    // a tree too deep to walk with recursion
+    ast_node_t* deep = root;
+    for(int i = 0; i < 1000000; i++) {
+        ast_node_t* n = create_node(ast, FUNC_BODY_NODE);
+        add_ast_node(ast, deep, n);
+        deep = n;
+    }
+    int depth[2] = {0, 0};
+    if(walk_ast(root, count_pre, count_post, depth) != AST_VISIT_CONTINUE ||
+            depth[0] != 1000103 || depth[1] != 1000103) {
+        printf("the deep walk saw %d and %d nodes\n", depth[0], depth[1]);
+        errors++;
+    }
+
+    flat_ast_t* deep_flat = flatten_ast(ast);
+    if(deep_flat->count != 1000103 || deep_flat->first_child[1000102] != NO_AST_INDEX) {
+        printf("the deep flat tree has %u nodes\n", deep_flat->count);
+        errors++;
+    }
+    destroy_flat_ast(deep_flat);
+    destroy_flat_ast(flat);
+    destroy_ast(ast);
+
+    printf("%s: %d errors\n", errors? "fail": "pass", errors);
+    return errors;
 }
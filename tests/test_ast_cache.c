@@ -0,0 +1,115 @@
+/*
+ * Check that a module that is put back from the AST cache has the same export
+ * tables for its imports as when it was parsed. The modules are the ones in
+ * this directory, so run it from here.
+ *
+ * Build as:
+ * gcc -Wall -Wextra -g test_ast_cache.c -I../src/include -L../lib -lparser -lsupport -lutils -lpthread
+ */
+#include <dirent.h>
+
+#include "common.h"
+
+BEGIN_CONFIG
+    CONFIG_NUM("-v", "VERBOSE", "Set the verbosity from 0 to 50", 0, 0)
+    CONFIG_LIST("-p", "FPATH", "Specify directories to search for imports", 0, ".")
+    CONFIG_BOOL("-m", "NO_MMAP", "Read source files into memory instead of mapping them", 0, 0)
+    CONFIG_STR("-c", "TOKEN_CACHE", "Keep the tokens of scanned files in this directory", 0, NULL)
+    CONFIG_STR("-s", "SCANNER", "Select the scanner: flex, fast, or diff to run both and compare", 0, "fast")
+    CONFIG_STR("-k", "AST_CACHE", "Keep the parsed modules in this directory", 0, NULL)
+END_CONFIG
+
+memory_system_t* memory_system;
+
+static int count_files(const char* dir) {
+
+    DIR* d = opendir(dir);
+    struct dirent* ent;
+    int count = 0;
+
+    if(d != NULL) {
+        while((ent = readdir(d)) != NULL)
+            if(ent->d_name[0] != '.')
+                count++;
+        closedir(d);
+    }
+    return count;
+}
+
+static void remove_dir(const char* dir) {
+
+    DIR* d = opendir(dir);
+    struct dirent* ent;
+    char fname[1024];
+
+    if(d != NULL) {
+        while((ent = readdir(d)) != NULL)
+            if(ent->d_name[0] != '.') {
+                snprintf(fname, sizeof(fname), "%s/%s", dir, ent->d_name);
+                remove(fname);
+            }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+/*
+ * Parse the module and check what its imports export. Returns the number of
+ * errors.
+ */
+static int check_exports(const char* run) {
+
+    int errors = 0;
+
+    ast_t* ast = parse("include_test");
+    if(ast == NULL) {
+        printf("%s: include_test did not parse\n", run);
+        return 1;
+    }
+
+    atom_t include1 = intern_string("include1");
+    atom_t name = intern_string("name");
+    ast_node_t* bacon = find_export(ast, include1, intern_string("bacon"));
+    ast_node_t* name1 = find_export(ast, name, intern_string("name1"));
+    if(bacon == NULL || get_node_name(bacon) != intern_string("bacon") ||
+            name1 == NULL || get_node_name(name1) != intern_string("name1") ||
+            find_export(ast, name, intern_string("bacon")) != NULL) {
+        printf("%s: the exports are wrong\n", run);
+        errors++;
+    }
+
+    destroy_ast(ast);
+    return errors;
+}
+
+int main(void) {
+
+    int errors = 0;
+    char dir[] = "/tmp/test_ast_cache_XXXXXX";
+
+    init_memory_system();
+    if(mkdtemp(dir) == NULL)
+        fatal_error("cannot make a directory for the cache: %s", strerror(errno));
+
+    char* argv[] = {"test_ast_cache", "-k", dir, "include_test", NULL};
+    configure(4, argv);
+    init_errors(0, stdout);
+
+    // the first time the modules are parsed and saved
+    errors += check_exports("parsed");
+    if(count_files(dir) == 0) {
+        printf("nothing was saved in %s\n", dir);
+        errors++;
+    }
+
+    // the second time they are put back from the cache
+    errors += check_exports("loaded");
+
+    remove_dir(dir);
+    flush_quarantine();
+    destroy_atoms();
+
+    errors += get_num_errors();
+    printf("%s: %d errors\n", errors? "fail": "pass", errors);
+    return errors;
+}
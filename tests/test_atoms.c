@@ -0,0 +1,93 @@
+/*
+ * Check that the same text always gives the same atom, also when more than
+ * one thread is making them.
+ *
+ * Build as:
+ * gcc -Wall -Wextra -g test_atoms.c -I../src/include -L../lib -lutils -lpthread
+ */
+#include <pthread.h>
+
+#include "common.h"
+
+memory_system_t* memory_system;
+
+#define NUM_THREADS 4
+#define NUM_NAMES 20000
+
+static atom_t made[NUM_THREADS][NUM_NAMES];
+
+static void* make_atoms(void* arg) {
+
+    atom_t* out = arg;
+    char buffer[32];
+
+    // each thread goes through the names in a different order
+    for(int i = 0; i < NUM_NAMES; i++) {
+        int n = (out == made[0])? i: NUM_NAMES - 1 - i;
+        snprintf(buffer, sizeof(buffer), "name_%d", n);
+        out[n] = intern_string(buffer);
+    }
+    return NULL;
+}
+
+int main(void) {
+
+    int errors = 0;
+    char text[] = "counter counter count";
+
+    init_memory_system();
+
+    // the text does not have to be terminated, and the atom is
+    atom_t a1 = intern_atom(&text[0], 7);
+    atom_t a2 = intern_atom(&text[8], 7);
+    atom_t a3 = intern_atom(&text[16], 5);
+    if(a1 != a2 || a1 == a3 || strcmp(a1, "counter") || strcmp(a3, "count") ||
+            atom_length(a1) != 7 || a1 == text) {
+        printf("the atoms are %p \"%s\", %p \"%s\", %p \"%s\"\n", a1, a1, a2, a2, a3, a3);
+        errors++;
+    }
+
+    if(find_atom("count", 5) != a3 || find_atom("coun", 4) != NULL || intern_string("") != intern_atom("", 0)) {
+        printf("find_atom() is wrong\n");
+        errors++;
+    }
+
+    pthread_t threads[NUM_THREADS];
+    for(int i = 0; i < NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, make_atoms, made[i]);
+    for(int i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    for(int n = 0; n < NUM_NAMES; n++) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "name_%d", n);
+        for(int i = 0; i < NUM_THREADS; i++)
+            if(made[i][n] != made[0][n] || strcmp(made[i][n], buffer)) {
+                printf("thread %d has \"%s\" for \"%s\"\n", i, made[i][n], buffer);
+                errors++;
+            }
+    }
+
+    if(num_atoms() != NUM_NAMES + 3) {
+        printf("there are %zu atoms\n", num_atoms());
+        errors++;
+    }
+
+    // the symbols are found by their atoms, whatever string the name is in
+    symbol_table_t table = create_symbol_table();
+    ast_t* ast = create_ast();
+    ast_node_t* node = create_node(ast, DATA_DEF_NODE);
+    add_symbol(table, "counter", node);
+    char name[] = "counter";
+    if(peek_symbol(table, name) != ST_NO_ERROR || peek_symbol(table, "nowhere") != ST_NOT_FOUND ||
+            add_symbol(table, a1, node) != ST_SYMBOL_EXISTS) {
+        printf("the symbol table does not find the atoms\n");
+        errors++;
+    }
+    destroy_symbol_table(table);
+    destroy_ast(ast);
+
+    destroy_atoms();
+    printf("%s: %d errors\n", errors? "fail": "pass", errors);
+    return errors;
+}
@@ -39,6 +39,141 @@ int main(void)
     int re = find_hash_table(tab, "poopoo", &buffer, sizeof(buffer));
     printf("glop = %s, 2 = %d\n", buffer, re);
 
+    // every other entry is removed and the rest can still be found
+    int errors = 0;
+    int num = 0;
+    size_t count = tab->count;
+    while(strs[num] != NULL)
+        num++;
+    for(int i = 0; i < num; i += 2)
+        if(remove_hash_table(tab, strs[i]) != HASH_NO_ERROR) {
+            printf("cannot remove %s\n", strs[i]);
+            errors++;
+        }
+    if(remove_hash_table(tab, "poopoo") != HASH_NOT_FOUND) {
+        printf("removed a key that is not there\n");
+        errors++;
+    }
+
+    for(int i = 1; i < num; i += 2) {
+        int want = strcmp(strs[i], "and")? HASH_NO_ERROR: HASH_NOT_FOUND;
+        if(find_hash_table(tab, strs[i], &buffer, sizeof(buffer)) != want ||
+                (want == HASH_NO_ERROR && strcmp(buffer, strs[i]))) {
+            printf("lost %s after the removals\n", strs[i]);
+            errors++;
+        }
+    }
+    for(int i = 0; i < num; i += 2)
+        if(find_hash_table(tab, strs[i], &buffer, sizeof(buffer)) != HASH_NOT_FOUND) {
+            printf("found %s after it was removed\n", strs[i]);
+            errors++;
+        }
+
+    // a walk inside another walk of the same table sees all of it
+    hash_cursor_t outer, inner;
+    size_t pairs = 0;
+    init_hash_cursor(&outer);
+    while(next_hash_entry(tab, &outer)) {
+        init_hash_cursor(&inner);
+        while(next_hash_entry(tab, &inner))
+            pairs++;
+        if(outer.size != strlen(outer.key) + 1 || strcmp(outer.data, outer.key)) {
+            printf("the cursor has %s for %s\n", (char*)outer.data, outer.key);
+            errors++;
+        }
+    }
+    if(pairs != tab->count * tab->count) {
+        printf("the nested walks saw %lu pairs of %lu entries\n", pairs, tab->count);
+        errors++;
+    }
+    printf("\nafter removing: count %lu (was %lu), tombstones %lu\n", tab->count, count, tab->tombstones);
+
+    // inserting and removing over and over does not fill the table
+    size_t capacity = tab->capacity;
+    for(int i = 0; i < 10000; i++) {
+        snprintf(buffer, sizeof(buffer), "key_%d", i);
+        insert_hash_table(tab, buffer, &i, sizeof(i));
+        remove_hash_table(tab, buffer);
+    }
+    if(tab->capacity != capacity || tab->count + tab->tombstones >= tab->capacity) {
+        printf("the table grew to %lu with %lu tombstones\n", tab->capacity, tab->tombstones);
+        errors++;
+    }
+
+    // and a table that grows keeps every entry
+    for(int i = 0; i < 10000; i++) {
+        snprintf(buffer, sizeof(buffer), "key_%d", i);
+        insert_hash_table(tab, buffer, &i, sizeof(i));
+    }
+    for(int i = 0; i < 10000; i++) {
+        int val = -1;
+        snprintf(buffer, sizeof(buffer), "key_%d", i);
+        if(find_hash_table(tab, buffer, &val, sizeof(val)) != HASH_NO_ERROR || val != i) {
+            printf("%s is %d\n", buffer, val);
+            errors++;
+        }
+    }
+
+    // data up to HASH_INLINE_SIZE is in the entry and bigger data is not
+    char small[HASH_INLINE_SIZE], big[HASH_INLINE_SIZE * 4], out[HASH_INLINE_SIZE * 4];
+    memset(small, 's', sizeof(small));
+    memset(big, 'b', sizeof(big));
+    insert_hash_table(tab, "small", small, sizeof(small));
+    insert_hash_table(tab, "big", big, sizeof(big));
+    if(find_hash_table(tab, "small", out, sizeof(out)) != HASH_NO_ERROR || memcmp(out, small, sizeof(small)) ||
+            find_hash_table(tab, "big", out, sizeof(out)) != HASH_NO_ERROR || memcmp(out, big, sizeof(big)) ||
+            find_hash_table_entry_size(tab, "big") != sizeof(big)) {
+        printf("the small or the big data is wrong\n");
+        errors++;
+    }
+    remove_hash_table(tab, "big");
+
+    destroy_hash_table(tab);
+
+    // the swiss table keeps the same entries through the same changes
+    swiss_table_t* sw = create_swiss_table();
+    for(int i = 0; i < 10000; i++) {
+        snprintf(buffer, sizeof(buffer), "key_%d", i);
+        insert_swiss_table(sw, buffer, &i, sizeof(i));
+        if(i % 3 == 0)
+            remove_swiss_table(sw, buffer);
+    }
+    if(insert_swiss_table(sw, "key_1", &errors, sizeof(errors)) != HASH_EXIST ||
+            remove_swiss_table(sw, "key_0") != HASH_NOT_FOUND) {
+        printf("the swiss table took a duplicate or removed a key twice\n");
+        errors++;
+    }
+    for(int i = 0; i < 10000; i++) {
+        int val = -1;
+        snprintf(buffer, sizeof(buffer), "key_%d", i);
+        int want = (i % 3 == 0)? HASH_NOT_FOUND: HASH_NO_ERROR;
+        if(find_swiss_table(sw, buffer, &val, sizeof(val)) != want || (want == HASH_NO_ERROR && val != i)) {
+            printf("swiss %s is %d\n", buffer, val);
+            errors++;
+        }
+    }
+    count = 0;
+    for(const char* key = iterate_swiss_table(sw, 1); key != NULL; key = iterate_swiss_table(sw, 0))
+        count++;
+    if(count != sw->count || count != 6666) {
+        printf("the swiss table has %lu keys and counted %lu\n", count, sw->count);
+        errors++;
+    }
+
+    // the cursor sees the same entries without copying them
+    hash_cursor_t cur;
+    long sum = 0;
+    init_hash_cursor(&cur);
+    while(next_swiss_entry(sw, &cur))
+        sum += *(int*)cur.data;
+    if(sum != 49995000L - 16668333L) {
+        printf("the swiss cursor added up to %ld\n", sum);
+        errors++;
+    }
+    destroy_swiss_table(sw);
+
+    printf("\n%s: %d errors\n", errors? "fail": "pass", errors);
+    return errors;
 }
 
 
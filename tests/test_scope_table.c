@@ -0,0 +1,88 @@
+/*
+ * Check that names in inner scopes hide the outer ones until the scope is
+ * popped, also when the scopes are very deep.
+ *
+ * Build as:
+ * gcc -Wall -Wextra -g test_scope_table.c -I../src/include -L../lib -lsupport -lutils -lpthread
+ */
+#include "common.h"
+
+memory_system_t* memory_system;
+
+#define DEPTH 100000
+
+int main(void) {
+
+    int errors = 0;
+    char buffer[32];
+
+    init_memory_system();
+
+    ast_t* ast = create_ast();
+    ast_node_t* outer = create_node(ast, FUNC_DEF_NODE);
+    ast_node_t* inner = create_node(ast, DATA_DEF_NODE);
+    ast_node_t* other = create_node(ast, DATA_DEF_NODE);
+    atom_t x = intern_string("x");
+    atom_t y = intern_string("y");
+
+    scope_table_t* table = create_scope_table();
+    add_scoped_symbol(table, x, outer);
+
+    push_scope(table);
+    if(add_scoped_symbol(table, x, inner) != ST_NO_ERROR || add_scoped_symbol(table, y, other) != ST_NO_ERROR ||
+            add_scoped_symbol(table, x, other) != ST_SYMBOL_EXISTS) {
+        printf("the inner scope did not take the names\n");
+        errors++;
+    }
+    if(find_scoped_symbol(table, x) != inner || find_scoped_symbol(table, y) != other) {
+        printf("the inner names are not seen\n");
+        errors++;
+    }
+
+    pop_scope(table);
+    if(find_scoped_symbol(table, x) != outer || find_scoped_symbol(table, y) != NULL || table->depth != 0) {
+        printf("the outer names are not back\n");
+        errors++;
+    }
+
+    // each scope hides x, and adds a name of its own
+    atom_t* names = MALLOC(DEPTH * sizeof(atom_t));
+    ast_node_t** nodes = MALLOC(DEPTH * sizeof(ast_node_t*));
+    for(int i = 0; i < DEPTH; i++) {
+        push_scope(table);
+        snprintf(buffer, sizeof(buffer), "local_%d", i);
+        names[i] = intern_string(buffer);
+        nodes[i] = create_node(ast, DATA_DEF_NODE);
+        add_scoped_symbol(table, x, nodes[i]);
+        add_scoped_symbol(table, names[i], nodes[i]);
+    }
+
+    for(int i = DEPTH - 1; i >= 0; i--) {
+        if(find_scoped_symbol(table, x) != nodes[i] || find_scoped_symbol(table, names[i]) != nodes[i] ||
+                find_scoped_symbol(table, names[0]) != nodes[0]) {
+            printf("scope %d sees the wrong names\n", i);
+            errors++;
+            break;
+        }
+        pop_scope(table);
+        if(find_scoped_symbol(table, names[i]) != NULL) {
+            printf("%s is still seen after its scope\n", names[i]);
+            errors++;
+            break;
+        }
+    }
+
+    if(find_scoped_symbol(table, x) != outer || table->names->count != 1 || table->undo->nitems != 0) {
+        printf("the deep scopes left %lu names behind\n", table->names->count);
+        errors++;
+    }
+
+    FREE(names);
+    FREE(nodes);
+    destroy_scope_table(table);
+    destroy_ast(ast);
+    destroy_atoms();
+
+    printf("%s: %d errors\n", errors? "fail": "pass", errors);
+    return errors;
+}
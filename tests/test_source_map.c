@@ -0,0 +1,56 @@
+/*
+ * Check that the line numbers stay right when the text is written into while
+ * it is scanned, the way flex does. Flex puts a zero after the token that it
+ * just found, so an error on the last token of a line is reported while the
+ * newline after it is gone.
+ *
+ * Build as:
+ * gcc -Wall -Wextra -g test_source_map.c -I../src/include -L../lib -lutils -lpthread
+ */
+#include "common.h"
+
+memory_system_t* memory_system;
+
+int main(void) {
+
+    int errors = 0;
+    int line, col;
+    const char* name;
+    // the padding after the text is where flex wants its two zero bytes
+    char text[] = "int a;\nint b\nint c;\n\0\0";
+    uint32_t size = strlen(text);
+    uint32_t b = strchr(text, 'b') - text;
+    uint32_t c = strchr(text, 'c') - text;
+
+    init_memory_system();
+
+    source_loc_t base = add_source_file(text, "lines.s", text, size);
+    // open_file() does this before it gives the text to flex
+    index_source_lines(base);
+
+    // the error on "b" comes while flex has the newline after it
+    text[b + 1] = '\0';
+    if(get_source_location(base + b, &name, &line, &col) || strcmp(name, "lines.s") || line != 2 || col != 5) {
+        printf("the token at the end of the line is at %d:%d\n", line, col);
+        errors++;
+    }
+    text[b + 1] = '\n';
+
+    if(get_source_location(base + c, NULL, &line, &col) || line != 3 || col != 5) {
+        printf("the next line is at %d:%d\n", line, col);
+        errors++;
+    }
+    if(get_source_location(base + size, NULL, &line, NULL) || line != 4) {
+        printf("the end of the file is on line %d\n", line);
+        errors++;
+    }
+
+    release_source_files(text);
+    if(get_source_location(base + c, NULL, &line, NULL) != -1) {
+        printf("a released file is still found\n");
+        errors++;
+    }
+
+    printf("%s: %d errors\n", errors? "fail": "pass", errors);
+    return errors;
+}
@@ -0,0 +1,118 @@
+/*
+ * Check that the symbol table gives back the nodes that were added, that
+ * dotted names go into the children of the nodes and the exports of modules,
+ * and that threads can add the same names at once.
+ *
+ * Build as:
+ * gcc -Wall -Wextra -g test_symbol_table.c -I../src/include -L../lib -lsupport -lutils -lpthread
+ */
+#include <pthread.h>
+
+#include "common.h"
+
+memory_system_t* memory_system;
+
+#define NUM_THREADS 4
+#define NUM_NAMES 20000
+
+static atom_t names[NUM_NAMES];
+static symbol_table_t shared_table;
+static ast_node_t* shared_node;
+
+static void* add_symbols(void* arg) {
+
+    int* added = arg;
+
+    for(int n = 0; n < NUM_NAMES; n++)
+        if(add_atom_symbol(shared_table, names[n], shared_node) == ST_NO_ERROR)
+            (*added)++;
+    return NULL;
+}
+
+int main(void) {
+
+    int errors = 0;
+    char buffer[32];
+
+    init_memory_system();
+
+    symbol_table_t table = create_symbol_table();
+    ast_t* ast = create_ast();
+    ast_node_t* node = create_node(ast, DATA_DEF_NODE);
+    add_symbol(table, "counter", node);
+
+    // the stripes start on cache lines
+    if(((uintptr_t)table & 63) != 0) {
+        printf("the table is at %p\n", (void*)table);
+        errors++;
+    }
+
+    // a look up gives back the node that was added, and dotted names go into its children
+    ast_node_t* point = create_node(ast, FUNC_DEF_NODE);
+    ast_node_t* member = create_node(ast, DATA_DEF_NODE);
+    set_node_str(point, NAME_ATTR, intern_string("point"));
+    set_node_str(member, NAME_ATTR, intern_string("x"));
+    add_ast_node(ast, point, member);
+    add_symbol(table, "point", point);
+    if(get_symbol_reference(table, "counter") != node || get_symbol_definition(table, "point") != point ||
+            get_symbol_definition(table, "point.x") != member || get_symbol_definition(table, "point.y") != NULL ||
+            get_symbol_definition(table, "point.x.x") != NULL || get_symbol_reference(table, "point.x") != NULL) {
+        printf("the symbol table gives back the wrong nodes\n");
+        errors++;
+    }
+
+    // a name after a module is found in what the module exports
+    ast_node_t* import = create_node(ast, IMPORT_NODE);
+    ast_node_t* shape = create_node(ast, FUNC_DEF_NODE);
+    ast_node_t* side = create_node(ast, DATA_DEF_NODE);
+    set_node_str(import, IMPORT_NAME_ATTR, intern_string("geometry"));
+    set_node_str(shape, NAME_ATTR, intern_string("shape"));
+    set_node_str(side, NAME_ATTR, intern_string("side"));
+    add_ast_node(ast, shape, side);
+    add_ast_node(ast, import, shape);
+    add_exports(ast, import);
+    if(get_symbol_definition(table, "geometry.shape") != NULL) {
+        printf("a module was found without its exports\n");
+        errors++;
+    }
+    set_symbol_exports(table, ast);
+    add_symbol(table, "imported", import);
+    if(get_symbol_definition(table, "geometry.shape") != shape ||
+            get_symbol_definition(table, "geometry.shape.side") != side ||
+            get_symbol_definition(table, "imported.shape.side") != side ||
+            get_symbol_definition(table, "geometry.side") != NULL || get_symbol_definition(table, "geometry") != NULL ||
+            get_symbol_definition(table, "point.x") != member) {
+        printf("the exports of a module are not found\n");
+        errors++;
+    }
+
+    // threads that add the same names at once add each of them once
+    for(int n = 0; n < NUM_NAMES; n++) {
+        snprintf(buffer, sizeof(buffer), "name_%d", n);
+        names[n] = intern_string(buffer);
+    }
+
+    pthread_t threads[NUM_THREADS];
+    int added[NUM_THREADS] = {0};
+    shared_table = table;
+    shared_node = node;
+    for(int i = 0; i < NUM_THREADS; i++)
+        pthread_create(&threads[i], NULL, add_symbols, &added[i]);
+    for(int i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    int total = 0;
+    for(int i = 0; i < NUM_THREADS; i++)
+        total += added[i];
+    if(total != NUM_NAMES || num_symbols(table) != NUM_NAMES + 3 ||
+            peek_atom_symbol(table, names[NUM_NAMES - 1]) != ST_NO_ERROR) {
+        printf("the threads added %d names and the table has %zu\n", total, num_symbols(table));
+        errors++;
+    }
+
+    destroy_symbol_table(table);
+    destroy_ast(ast);
+
+    destroy_atoms();
+    printf("%s: %d errors\n", errors? "fail": "pass", errors);
+    return errors;
+}